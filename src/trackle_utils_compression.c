@@ -0,0 +1,243 @@
+#include <trackle_utils_compression.h>
+
+#include <string.h>
+
+#define MIN_MATCH_LENGTH 3
+#define MAX_MATCH_LENGTH (MIN_MATCH_LENGTH + 0x3F) // Length is stored in 6 bits
+#define MAX_CHAIN_LENGTH 16                        // Max number of candidates checked for every match, bounding the time spent on repetitive data
+#define HEADER_LENGTH 2                            // Length of the original data, little endian
+
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Hash of the 3 bytes starting at p, in [0, TRACKLE_COMPRESSION_HASH_SIZE)
+static inline int hash3(const uint8_t *p)
+{
+    const uint32_t bytes = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (uint32_t)(bytes * 2654435761UL) >> 24; // Multiplicative hash, top 8 bits
+}
+
+static inline void insertPosition(Trackle_CompressionWorkspace_t *workspace, const uint8_t *src, int srcLen, int pos)
+{
+    if (pos + MIN_MATCH_LENGTH <= srcLen)
+    {
+        const int hash = hash3(&src[pos]);
+        workspace->prev[pos % TRACKLE_COMPRESSION_WINDOW_SIZE] = workspace->head[hash];
+        workspace->head[hash] = pos + 1;
+    }
+}
+
+// Returns the length of the longest match of the data at pos within the window, storing its distance in matchDistance.
+static int findLongestMatch(const Trackle_CompressionWorkspace_t *workspace, const uint8_t *src, int srcLen, int pos, int *matchDistance)
+{
+    if (pos + MIN_MATCH_LENGTH > srcLen)
+    {
+        return 0;
+    }
+    const int maxLength = srcLen - pos < MAX_MATCH_LENGTH ? srcLen - pos : MAX_MATCH_LENGTH;
+    int bestLength = 0;
+    int candidate = workspace->head[hash3(&src[pos])];
+    for (int chain = 0; candidate != 0 && chain < MAX_CHAIN_LENGTH; chain++)
+    {
+        const int candidatePos = candidate - 1;
+        if (pos - candidatePos > TRACKLE_COMPRESSION_WINDOW_SIZE)
+        {
+            break; // Older candidates are out of the window too
+        }
+        int length = 0;
+        while (length < maxLength && src[candidatePos + length] == src[pos + length])
+        {
+            length++;
+        }
+        if (length > bestLength)
+        {
+            bestLength = length;
+            *matchDistance = pos - candidatePos;
+            if (length == maxLength)
+            {
+                break;
+            }
+        }
+        candidate = workspace->prev[candidatePos % TRACKLE_COMPRESSION_WINDOW_SIZE];
+    }
+    return bestLength;
+}
+
+int Trackle_Compression_compress(Trackle_CompressionWorkspace_t *workspace, const uint8_t *src, int srcLen, uint8_t *dst, int dstSize)
+{
+    if (srcLen < 0 || srcLen > TRACKLE_COMPRESSION_MAX_LENGTH || dstSize < HEADER_LENGTH)
+    {
+        return -1;
+    }
+    memset(workspace->head, 0, sizeof(workspace->head));
+
+    dst[0] = srcLen & 0xFF;
+    dst[1] = srcLen >> 8;
+    int dstLen = HEADER_LENGTH;
+    int flagsPos = 0;
+    int flagBit = 8; // Next item needs a new flag byte
+    int pos = 0;
+    while (pos < srcLen)
+    {
+        if (flagBit == 8)
+        {
+            if (dstLen >= dstSize)
+            {
+                return -1;
+            }
+            flagsPos = dstLen++;
+            dst[flagsPos] = 0;
+            flagBit = 0;
+        }
+        int matchDistance = 0;
+        const int matchLength = findLongestMatch(workspace, src, srcLen, pos, &matchDistance);
+        if (matchLength >= MIN_MATCH_LENGTH)
+        {
+            if (dstLen + 2 > dstSize)
+            {
+                return -1;
+            }
+            dst[dstLen++] = (matchDistance - 1) & 0xFF;
+            dst[dstLen++] = (((matchDistance - 1) >> 8) << 6) | (matchLength - MIN_MATCH_LENGTH);
+            for (int i = 0; i < matchLength; i++)
+            {
+                insertPosition(workspace, src, srcLen, pos + i);
+            }
+            pos += matchLength;
+        }
+        else
+        {
+            if (dstLen + 1 > dstSize)
+            {
+                return -1;
+            }
+            dst[flagsPos] |= 1 << flagBit;
+            dst[dstLen++] = src[pos];
+            insertPosition(workspace, src, srcLen, pos);
+            pos++;
+        }
+        flagBit++;
+    }
+    return dstLen;
+}
+
+int Trackle_Compression_decompress(const uint8_t *src, int srcLen, uint8_t *dst, int dstSize)
+{
+    if (srcLen < HEADER_LENGTH)
+    {
+        return -1;
+    }
+    const int dstLen = src[0] | (src[1] << 8);
+    if (dstLen > dstSize)
+    {
+        return -1;
+    }
+    int srcPos = HEADER_LENGTH;
+    int dstPos = 0;
+    while (dstPos < dstLen)
+    {
+        if (srcPos >= srcLen)
+        {
+            return -1;
+        }
+        const uint8_t flags = src[srcPos++];
+        for (int bit = 0; bit < 8 && dstPos < dstLen; bit++)
+        {
+            if (flags & (1 << bit))
+            {
+                if (srcPos >= srcLen)
+                {
+                    return -1;
+                }
+                dst[dstPos++] = src[srcPos++];
+                continue;
+            }
+            if (srcPos + 2 > srcLen)
+            {
+                return -1;
+            }
+            const int distance = (((src[srcPos + 1] >> 6) << 8) | src[srcPos]) + 1;
+            const int length = (src[srcPos + 1] & 0x3F) + MIN_MATCH_LENGTH;
+            srcPos += 2;
+            if (distance > dstPos || dstPos + length > dstLen)
+            {
+                return -1;
+            }
+            for (int i = 0; i < length; i++) // Byte by byte, as the match can overlap the bytes being written
+            {
+                dst[dstPos] = dst[dstPos - distance];
+                dstPos++;
+            }
+        }
+    }
+    return dstLen;
+}
+
+int Trackle_Compression_base64Encode(const uint8_t *src, int srcLen, char *dst, int dstSize)
+{
+    const int dstLen = (srcLen + 2) / 3 * 4;
+    if (srcLen < 0 || dstLen + 1 > dstSize)
+    {
+        return -1;
+    }
+    char *out = dst;
+    for (int i = 0; i < srcLen; i += 3)
+    {
+        const int remaining = srcLen - i;
+        const uint32_t triple = (src[i] << 16) | (remaining > 1 ? src[i + 1] << 8 : 0) | (remaining > 2 ? src[i + 2] : 0);
+        *out++ = BASE64_CHARS[(triple >> 18) & 0x3F];
+        *out++ = BASE64_CHARS[(triple >> 12) & 0x3F];
+        *out++ = remaining > 1 ? BASE64_CHARS[(triple >> 6) & 0x3F] : '=';
+        *out++ = remaining > 2 ? BASE64_CHARS[triple & 0x3F] : '=';
+    }
+    *out = '\0';
+    return dstLen;
+}
+
+static int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+int Trackle_Compression_base64Decode(const char *src, int srcLen, uint8_t *dst, int dstSize)
+{
+    if (srcLen < 0 || srcLen % 4 != 0)
+    {
+        return -1;
+    }
+    int dstLen = 0;
+    for (int i = 0; i < srcLen; i += 4)
+    {
+        const bool last = i + 4 == srcLen;
+        const int padding = last ? (src[i + 3] == '=') + (src[i + 2] == '=') : 0;
+        uint32_t quad = 0;
+        for (int j = 0; j < 4; j++)
+        {
+            const int value = j >= 4 - padding ? 0 : base64Value(src[i + j]);
+            if (value < 0)
+            {
+                return -1;
+            }
+            quad = (quad << 6) | value;
+        }
+        if (dstLen + 3 - padding > dstSize)
+        {
+            return -1;
+        }
+        dst[dstLen++] = quad >> 16;
+        if (padding < 2)
+            dst[dstLen++] = (quad >> 8) & 0xFF;
+        if (padding < 1)
+            dst[dstLen++] = quad & 0xFF;
+    }
+    return dstLen;
+}
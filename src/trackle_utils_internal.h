@@ -0,0 +1,54 @@
+#ifndef TRACKLE_UTILS_INTERNAL_H
+#define TRACKLE_UTILS_INTERNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+ * Functions shared between the modules of the component and its host tools. They are not part of the public API.
+ *
+ * Every task of the component is a loop that waits and then runs one iteration of its work, implemented by the functions below.
+ * The same iterations are run by the dedicated task of each module, or by the unified task (see trackle_utils_scheduler.h).
+ */
+
+// Convert the delay returned by an iteration to ticks, rounding it up to at least one tick:
+// a delay shorter than a tick would truncate to 0, and the task would spin without yielding until the next tick.
+static inline TickType_t trackleDelayMsToTicks(uint32_t delayMs)
+{
+    const TickType_t delayTicks = delayMs / portTICK_PERIOD_MS + (delayMs % portTICK_PERIOD_MS != 0);
+    return delayTicks > 0 ? delayTicks : 1;
+}
+
+// Prepare the properties for publishing and, if senderTask is true, start the sender task. Otherwise the caller must run tracklePropertiesTransmit.
+// Returns false on errors or if already started.
+bool tracklePropertiesStart(bool senderTask);
+
+// Undo tracklePropertiesStart(false), if the task that would run tracklePropertiesTick and tracklePropertiesTransmit can't be started.
+void tracklePropertiesCancelStart();
+
+// Set the task that runs tracklePropertiesTick, to be notified on updates of urgent properties and on updates while it's backed off.
+// An iteration run because of a notification restarts the wait from that moment, with the delay it returns.
+void tracklePropertiesSetTaskHandle(TaskHandle_t taskHandle);
+
+// Run one iteration of the properties task: gather changed properties and hand them to the sender. Returns the ms to wait before the next iteration.
+uint32_t tracklePropertiesTick(uint32_t nowMs, bool connected);
+
+// Transmit the next buffer handed to the sender by the properties task, waiting up to ticksToWait for one if none is queued. Returns false if no buffer was transmitted.
+bool tracklePropertiesTransmit(TickType_t ticksToWait);
+
+// Mark notifications as serviced by a task. Returns false if already started.
+bool trackleNotificationsStart();
+
+// Undo trackleNotificationsStart, if the task that would run trackleNotificationsTick can't be started.
+void trackleNotificationsCancelStart();
+
+// Set the task that runs trackleNotificationsTick, to be notified on updates while it's backed off.
+void trackleNotificationsSetTaskHandle(TaskHandle_t taskHandle);
+
+// Run one iteration of the notifications task: publish the notifications whose level changed. Returns the ms to wait before the next iteration.
+uint32_t trackleNotificationsTick(uint32_t nowMs, bool connected);
+
+#endif
@@ -9,6 +9,8 @@
 
 #include <trackle_esp32.h>
 
+#include "trackle_utils_internal.h"
+
 #define MESSAGE_BUFFER_LEN 1024 // Length of the buffer that holds the string of the notification while it's being built.
 
 #define TRACKLE_NOTIFICATIONS_TASK_NAME "trackle_utils_notifications"
@@ -20,26 +22,84 @@
 static const char *TAG = "trackle_utils_notifications";
 static const char *EMPTY_STRING = "";
 
-#define NOTIFICATION_NAME_LENGTH 64
-#define NOTIFICATION_EVENT_LENGTH 64
-#define NOTIFICATION_FORMAT_LENGTH 128
+#if TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE > UINT16_MAX
+#error "TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE must fit the 16 bits offsets of Notification_t"
+#endif
 
 // Notification data structure
 typedef struct
 {
-    char key[NOTIFICATION_NAME_LENGTH];      // Notification name/key
-    char event[NOTIFICATION_EVENT_LENGTH];   // Notification event
-    char format[NOTIFICATION_FORMAT_LENGTH]; // Notification format
-    bool changed;                            // True if read value is changed
-    bool sign;                               // True if int32, false if uint32
-    int32_t value;                           // Latest read value
-    uint16_t scale;                          // Scale factor (divides new value when set)
-    uint8_t numDecimals;                     // Number of decimal digits (only used if scale is set)
+    uint16_t keyOffset;                                      // Offset of the notification name/key in the string pool
+    uint16_t eventOffset;                                    // Offset of the notification event in the string pool
+    uint16_t formatOffset;                                   // Offset of the notification format in the string pool
+    bool changed;                                            // True if read value is changed
+    bool sign;                                               // True if int32, false if uint32
+    int32_t value;                                           // Latest read value
+    uint16_t scale;                                          // Scale factor (divides new value when set)
+    uint8_t numDecimals;                                     // Number of decimal digits (only used if scale is set)
     uint8_t level;
+    bool pending;                                            // True if a new level is waiting for minHoldMs before being committed
+    uint8_t pendingLevel;                                    // Level waiting to be committed
+    int32_t pendingValue;                                    // Latest value received with the pending level
+    uint32_t pendingSinceMs;                                 // Time the pending level was first received
+    uint32_t minHoldMs;                                      // Time a new level must be held before being committed (0 to commit it immediately)
+    uint8_t numThresholds;                                   // Number of thresholds used to compute the level from the value (0 if the level is given by the user)
+    int32_t hysteresis;                                      // Amount the value must fall below a threshold to leave the level above it
+    int32_t thresholds[TRACKLE_MAX_NOTIFICATION_THRESHOLDS]; // Ascending values where the level increments
 } Notification_t;
 
 static Notification_t notifications[TRACKLE_MAX_NOTIFICATIONS_NUM] = {0}; // Array holding the notifications created by the user.
 static int numNotificationsCreated = 0;                                   // Number of the notifications created (aka next notification ID available)
+static bool notificationsStarted = false;                                 // True once notifications are serviced by a task
+static TaskHandle_t notificationsTaskHandle = NULL;                       // Handle of the task servicing notifications, notified on updates while it's backed off.
+
+static uint32_t minPeriodMs = TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS;     // Period of the notifications task while notifications are changing
+static uint32_t maxPeriodMs = TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS;     // Max period of the notifications task while nothing changes
+static uint32_t currentPeriodMs = TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS; // Period of the notifications task, doubled at every idle iteration up to maxPeriodMs
+
+static char stringPool[TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE] = {0}; // Null terminated names, events and formats of the notifications, each stored once.
+static int stringPoolUsed = 0;                                        // Number of chars used in the string pool
+
+static const char *getPooledString(uint16_t offset)
+{
+    return &stringPool[offset];
+}
+
+// Returns the offset of the string in the pool, or -1 if it's not there.
+static int findPooledString(const char *str)
+{
+    int offset = 0;
+    while (offset < stringPoolUsed)
+    {
+        const char *pooled = &stringPool[offset];
+        if (strcmp(pooled, str) == 0)
+        {
+            return offset;
+        }
+        offset += strlen(pooled) + 1;
+    }
+    return -1;
+}
+
+// Number of chars needed to add the string to the pool (0 if it's already there).
+static int getPoolSpaceNeeded(const char *str)
+{
+    return findPooledString(str) >= 0 ? 0 : strlen(str) + 1;
+}
+
+// Returns the offset of the string in the pool, adding it if it's not there. The caller must check that there is enough space.
+static uint16_t internString(const char *str)
+{
+    const int offset = findPooledString(str);
+    if (offset >= 0)
+    {
+        return offset;
+    }
+    const int newOffset = stringPoolUsed;
+    strcpy(&stringPool[newOffset], str);
+    stringPoolUsed += strlen(str) + 1;
+    return newOffset;
+}
 
 static bool makeMessageStringFromNotification(char *messageBuffer, int notificationIndex)
 {
@@ -64,40 +124,191 @@ static bool makeMessageStringFromNotification(char *messageBuffer, int notificat
         sprintf(valueBuffer, doubleFormatString, ((double)notifications[notificationIndex].value) / notifications[notificationIndex].scale);
     }
     return sprintf(messageBuffer,
-                   notifications[notificationIndex].format,
-                   notifications[notificationIndex].key,
+                   getPooledString(notifications[notificationIndex].formatOffset),
+                   getPooledString(notifications[notificationIndex].keyOffset),
                    notifications[notificationIndex].level,
                    valueBuffer) >= 0;
 }
 
-static void trackleNotificationsTaskCode(void *arg)
+// Commit the level: it will be published at the next iteration.
+static void commitLevel(int notificationIndex, uint8_t newLevel, int32_t value)
 {
+    notifications[notificationIndex].value = value;
+    notifications[notificationIndex].level = newLevel;
+    notifications[notificationIndex].pending = false;
+    notifications[notificationIndex].changed = true;
+}
 
-    static char messageBuffer[MESSAGE_BUFFER_LEN];
+// Commit the level if it differs from the current one, or make it wait for the min hold time of the notification.
+static void applyLevel(int notificationIndex, uint8_t newLevel, int32_t value)
+{
+    Notification_t *notification = &notifications[notificationIndex];
+    if (notification->level == newLevel)
+    {
+        notification->pending = false; // Back to the committed level before the hold time elapsed
+        return;
+    }
+    if (notification->minHoldMs == 0)
+    {
+        commitLevel(notificationIndex, newLevel, value);
+    }
+    else if (!notification->pending || notification->pendingLevel != newLevel)
+    {
+        notification->pendingLevel = newLevel;
+        notification->pendingValue = value;
+        notification->pendingSinceMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        notification->pending = true;
+    }
+    else
+    {
+        notification->pendingValue = value;
+        return; // Already waiting for the hold time
+    }
+    if (currentPeriodMs > minPeriodMs && notificationsTaskHandle != NULL)
+    {
+        xTaskNotifyGive(notificationsTaskHandle); // Don't wait for the backed off period
+    }
+}
 
-    TickType_t latestWakeTime = xTaskGetTickCount();
+// Level of the value according to the thresholds of the notification, starting from its latest level.
+// A threshold is crossed upwards when the value reaches it, and downwards when the value falls below it by more than the hysteresis,
+// so the loops run once per threshold crossed: usually zero or one times.
+static uint8_t computeLevel(const Notification_t *notification, int32_t value)
+{
+    int level = notification->pending ? notification->pendingLevel : notification->level;
+    if (level > notification->numThresholds)
+    {
+        level = notification->numThresholds; // Level set by the user beyond the table
+    }
+    while (level < notification->numThresholds && value >= notification->thresholds[level])
+    {
+        level++;
+    }
+    while (level > 0 && (int64_t)value < (int64_t)notification->thresholds[level - 1] - notification->hysteresis)
+    {
+        level--;
+    }
+    return level;
+}
 
-    for (;;)
+// Snap the period of the task to the min if there is something to publish, double it otherwise.
+static uint32_t updatePeriod(bool active)
+{
+    if (active)
+    {
+        currentPeriodMs = minPeriodMs;
+    }
+    else if (currentPeriodMs < maxPeriodMs)
+    {
+        currentPeriodMs = currentPeriodMs <= maxPeriodMs / 2 ? currentPeriodMs * 2 : maxPeriodMs;
+    }
+    return currentPeriodMs;
+}
+
+// Commit the pending levels held for their min hold time. Returns the time until the next one must be committed (UINT32_MAX if none).
+static uint32_t commitHeldLevels(uint32_t nowMs)
+{
+    uint32_t nextCommitMs = UINT32_MAX;
+    for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+    {
+        if (notifications[aIdx].pending)
+        {
+            const uint32_t heldMs = nowMs - notifications[aIdx].pendingSinceMs;
+            if (heldMs >= notifications[aIdx].minHoldMs)
+            {
+                commitLevel(aIdx, notifications[aIdx].pendingLevel, notifications[aIdx].pendingValue);
+            }
+            else if (notifications[aIdx].minHoldMs - heldMs < nextCommitMs)
+            {
+                nextCommitMs = notifications[aIdx].minHoldMs - heldMs;
+            }
+        }
+    }
+    return nextCommitMs;
+}
+
+uint32_t trackleNotificationsTick(uint32_t nowMs, bool connected)
+{
+    static char messageBuffer[MESSAGE_BUFFER_LEN]; // Static, to keep it out of the stack of the task running the iteration
+    const uint32_t nextCommitMs = commitHeldLevels(nowMs);
+
+    bool active = nextCommitMs != UINT32_MAX;
+    for (int aIdx = 0; aIdx < numNotificationsCreated && !active; aIdx++)
     {
+        active = notifications[aIdx].changed;
+    }
 
-        vTaskDelayUntil(&latestWakeTime, TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS / portTICK_PERIOD_MS);
+    if (!connected)
+    {
+        const uint32_t delayMs = updatePeriod(active); // Changed notifications are published once connected
+        return nextCommitMs < delayMs ? nextCommitMs : delayMs;
+    }
 
-        // For each notification ...
-        for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+    // For each notification ...
+    for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+    {
+        // ... if its level changed ...
+        if (notifications[aIdx].changed)
         {
-            // ... if its level changed ...
-            if (notifications[aIdx].changed)
+            // ... make string representation and publish it.
+            makeMessageStringFromNotification(messageBuffer, aIdx);
+            const bool success = tracklePublishSecure(getPooledString(notifications[aIdx].eventOffset), messageBuffer);
+            if (success) // on failure, publishing is retried at next period.
             {
-                // ... make string representation and publish it.
-                makeMessageStringFromNotification(messageBuffer, aIdx);
-                const bool success = tracklePublishSecure(notifications[aIdx].event, messageBuffer);
-                if (success) // on failure, publishing is retried at next period.
-                {
-                    notifications[aIdx].changed = false;
-                }
+                notifications[aIdx].changed = false;
             }
         }
     }
+    const uint32_t delayMs = updatePeriod(active);
+    return nextCommitMs < delayMs ? nextCommitMs : delayMs; // Commit held levels on time
+}
+
+static void trackleNotificationsTaskCode(void *arg)
+{
+
+    TickType_t latestWakeTime = xTaskGetTickCount();
+    uint32_t delayMs = TRACKLE_NOTIFICATIONS_TASK_PERIOD_MS;
+
+    for (;;)
+    {
+        // Wait for next iteration, or for an update while the task is backed off.
+        const TickType_t delayTicks = trackleDelayMsToTicks(delayMs);
+        const TickType_t elapsedTicks = xTaskGetTickCount() - latestWakeTime;
+        if (elapsedTicks < delayTicks)
+        {
+            ulTaskNotifyTake(pdTRUE, delayTicks - elapsedTicks);
+        }
+        if (xTaskGetTickCount() - latestWakeTime >= delayTicks)
+        {
+            latestWakeTime += delayTicks;
+        }
+        else
+        {
+            latestWakeTime = xTaskGetTickCount(); // Woken up early, next delay starts now
+        }
+        delayMs = trackleNotificationsTick(xTaskGetTickCount() * portTICK_PERIOD_MS, trackleConnected(trackle_s));
+    }
+}
+
+bool trackleNotificationsStart()
+{
+    if (notificationsStarted)
+    {
+        ESP_LOGE(TAG, "Already started.");
+        return false;
+    }
+    notificationsStarted = true;
+    return true;
+}
+
+void trackleNotificationsCancelStart()
+{
+    notificationsStarted = false;
+}
+
+void trackleNotificationsSetTaskHandle(TaskHandle_t taskHandle)
+{
+    notificationsTaskHandle = taskHandle;
 }
 
 bool Trackle_Notifications_startTask()
@@ -105,6 +316,11 @@ bool Trackle_Notifications_startTask()
 
     ESP_LOGI(TAG, "Initializing...");
 
+    if (!trackleNotificationsStart())
+    {
+        return false;
+    }
+
     // Task creation
     BaseType_t taskCreationRes;
 
@@ -113,10 +329,10 @@ bool Trackle_Notifications_startTask()
                                               TRACKLE_NOTIFICATIONS_TASK_STACK_SIZE,
                                               NULL,
                                               TRACKLE_NOTIFICATIONS_TASK_PRIORITY,
-                                              NULL,
+                                              &notificationsTaskHandle,
                                               TRACKLE_NOTIFICATIONS_TASK_CORE_ID);
 
-    if (taskCreationRes != ESP_OK)
+    if (taskCreationRes == pdTRUE)
     {
         ESP_LOGI(TAG, "Task created successfully.");
         return true;
@@ -130,60 +346,117 @@ Trackle_NotificationID_t Trackle_Notification_create(const char *name, const cha
     if (numNotificationsCreated < TRACKLE_MAX_NOTIFICATIONS_NUM)
     {
         const int newNotificationIndex = numNotificationsCreated;
-        for (int aIdx = 0; aIdx < numNotificationsCreated; aIdx++)
+        const int nameOffset = findPooledString(name);
+        for (int aIdx = 0; nameOffset >= 0 && aIdx < numNotificationsCreated; aIdx++)
         {
-            if (strcmp(name, notifications[aIdx].key) == 0)
+            if (notifications[aIdx].keyOffset == nameOffset)
             {
                 return Trackle_NotificationID_ERROR;
             }
         }
-        if (strlen(name) < NOTIFICATION_NAME_LENGTH)
+        // Strings equal to each other are stored only once, so the space is computed adding them one at a time.
+        int spaceNeeded = getPoolSpaceNeeded(name);
+        if (strcmp(eventName, name) != 0)
         {
-            strcpy(notifications[newNotificationIndex].key, name);
+            spaceNeeded += getPoolSpaceNeeded(eventName);
         }
-        else
+        if (strcmp(format, name) != 0 && strcmp(format, eventName) != 0)
         {
-            return Trackle_NotificationID_ERROR;
+            spaceNeeded += getPoolSpaceNeeded(format);
         }
-        if (strlen(eventName) < NOTIFICATION_EVENT_LENGTH)
-        {
-            strcpy(notifications[newNotificationIndex].event, eventName);
-        }
-        else
-        {
-            return Trackle_NotificationID_ERROR;
-        }
-        if (strlen(format) < NOTIFICATION_FORMAT_LENGTH)
-        {
-            strcpy(notifications[newNotificationIndex].format, format);
-        }
-        else
+        if (stringPoolUsed + spaceNeeded > TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE)
         {
+            ESP_LOGE(TAG, "String pool full, can't create notification %s", name);
             return Trackle_NotificationID_ERROR;
         }
+        notifications[newNotificationIndex].keyOffset = internString(name);
+        notifications[newNotificationIndex].eventOffset = internString(eventName);
+        notifications[newNotificationIndex].formatOffset = internString(format);
         notifications[newNotificationIndex].value = -1;
         notifications[newNotificationIndex].scale = scale;
         notifications[newNotificationIndex].sign = sign;
         notifications[newNotificationIndex].numDecimals = numDecimals;
         notifications[newNotificationIndex].changed = false;
         notifications[newNotificationIndex].level = 0;
+        notifications[newNotificationIndex].pending = false;
+        notifications[newNotificationIndex].minHoldMs = 0;
+        notifications[newNotificationIndex].numThresholds = 0;
+        notifications[newNotificationIndex].hysteresis = 0;
         numNotificationsCreated++;
         return newNotificationIndex + 1; // Convert internal notification index to notification ID by incrementing it.
     }
     return Trackle_NotificationID_ERROR;
 }
 
-bool Trackle_Notification_update(Trackle_NotificationID_t notificationID, uint8_t newLevel, int value)
+bool Trackle_Notifications_setAdaptivePeriod(uint32_t newMinPeriodMs, uint32_t newMaxPeriodMs)
+{
+    if (newMinPeriodMs == 0 || newMaxPeriodMs < newMinPeriodMs)
+    {
+        return false;
+    }
+    minPeriodMs = newMinPeriodMs;
+    maxPeriodMs = newMaxPeriodMs;
+    currentPeriodMs = newMinPeriodMs;
+    return true;
+}
+
+uint32_t Trackle_Notifications_getCurrentPeriod()
+{
+    return currentPeriodMs;
+}
+
+bool Trackle_Notification_setMinHold(Trackle_NotificationID_t notificationID, uint32_t minHoldMs)
 {
     const int notificationIndex = notificationID - 1; // Convert notification ID to internal notification index by decrementing it.
     if (notificationIndex >= 0 && notificationIndex < numNotificationsCreated)
     {
-        if (notifications[notificationIndex].level != newLevel)
+        notifications[notificationIndex].minHoldMs = minHoldMs;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Notification_setThresholds(Trackle_NotificationID_t notificationID, const int *thresholds, int numThresholds, int hysteresis)
+{
+    const int notificationIndex = notificationID - 1; // Convert notification ID to internal notification index by decrementing it.
+    if (notificationIndex < 0 || notificationIndex >= numNotificationsCreated ||
+        numThresholds < 0 || numThresholds > TRACKLE_MAX_NOTIFICATION_THRESHOLDS || (numThresholds > 0 && thresholds == NULL) || hysteresis < 0)
+    {
+        return false;
+    }
+    for (int tIdx = 1; tIdx < numThresholds; tIdx++)
+    {
+        if (thresholds[tIdx] <= thresholds[tIdx - 1])
         {
-            notifications[notificationIndex].changed = true;
-            notifications[notificationIndex].value = value;
-            notifications[notificationIndex].level = newLevel;
+            return false; // Not ascending
         }
+    }
+    for (int tIdx = 0; tIdx < numThresholds; tIdx++)
+    {
+        notifications[notificationIndex].thresholds[tIdx] = thresholds[tIdx];
+    }
+    notifications[notificationIndex].numThresholds = numThresholds;
+    notifications[notificationIndex].hysteresis = hysteresis;
+    return true;
+}
+
+bool Trackle_Notification_update(Trackle_NotificationID_t notificationID, uint8_t newLevel, int value)
+{
+    const int notificationIndex = notificationID - 1; // Convert notification ID to internal notification index by decrementing it.
+    if (notificationIndex >= 0 && notificationIndex < numNotificationsCreated)
+    {
+        applyLevel(notificationIndex, newLevel, value);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Notification_updateValue(Trackle_NotificationID_t notificationID, int value)
+{
+    const int notificationIndex = notificationID - 1; // Convert notification ID to internal notification index by decrementing it.
+    if (notificationIndex >= 0 && notificationIndex < numNotificationsCreated && notifications[notificationIndex].numThresholds > 0)
+    {
+        applyLevel(notificationIndex, computeLevel(&notifications[notificationIndex], value), value);
         return true;
     }
     return false;
@@ -194,7 +467,7 @@ const char *Trackle_Notification_getKey(Trackle_NotificationID_t notificationID)
     const int notificationIndex = notificationID - 1; // Convert notification ID to internal notification index by decrementing it.
     if (notificationIndex >= 0 && notificationIndex < numNotificationsCreated)
     {
-        return notifications[notificationIndex].key;
+        return getPooledString(notifications[notificationIndex].keyOffset);
     }
     return EMPTY_STRING;
 }
@@ -2,14 +2,29 @@
 
 #include <string.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_log.h>
 
 #include <trackle_esp32.h>
 
+#include <trackle_utils_compression.h>
+
+#include "trackle_utils_internal.h"
+
 #define JSON_BUFFER_LEN 1024 // Length of the buffer that holds the JSON string of the properties while it's being built.
+#define SYNC_BUFFERS_NUM 2   // Number of JSON buffers: one is filled by the properties task while the other is transmitted by the sender task.
+#define NO_SYNC_BUFFER -1    // Index meaning "no buffer"
+#define NO_RESUME_PROP -1    // Index meaning "no publication of the group to be resumed"
+
+#define STRING_PROP_JSON_OVERHEAD (sizeof("{\"\":\"\"}") + 1) // Room a sync buffer needs besides name and value of a string property alone in it (+1 as the null terminator is reserved twice)
+#define VERSION_MEMBER_MAX_LEN (sizeof(",\"" TRACKLE_PROPS_VERSION_KEY "\":[4294967295,4294967295]") - 1) // Max length of the versions appended to a synchronization
+
+#define COMPRESSED_JSON_BUFFER_LEN (sizeof("{\"" TRACKLE_COMPRESSION_ENVELOPE_KEY "\":\"\"}") + (JSON_BUFFER_LEN + 2) / 3 * 4) // Length of the buffer holding a compressed synchronization, wrapped in its JSON envelope
 
 #define TRACKLE_PROPERTIES_TASK_NAME "trackle_utils_properties"
 #define TRACKLE_PROPERTIES_TASK_STACK_SIZE 8192
@@ -17,48 +32,185 @@
 #define TRACKLE_PROPERTIES_TASK_CORE_ID 1
 #define TRACKLE_PROPERTIES_TASK_PERIOD_MS 100
 
+#define URGENT_FLUSH_DEFAULT_MIN_INTERVAL_MS 1000 // Default minimum time between two flushes triggered by urgent properties
+
+#define TRACKLE_PROPERTIES_SENDER_TASK_NAME "trackle_utils_props_sender"
+#define TRACKLE_PROPERTIES_SENDER_TASK_STACK_SIZE 8192
+
 static const char *TAG = "trackle_utils_properties";
 static const char *EMPTY_STRING = "";
 
-// Property data structure
+// Value of a non-string property, interpreted according to the type of the property
+typedef union
+{
+    int32_t fixed;   // TRACKLE_PROP_TYPE_FIXED
+    bool boolean;    // TRACKLE_PROP_TYPE_BOOL
+    int64_t int64;   // TRACKLE_PROP_TYPE_INT64
+    uint64_t uint64; // TRACKLE_PROP_TYPE_UINT64
+    float real;      // TRACKLE_PROP_TYPE_FLOAT
+    struct
+    {
+        uint32_t hash;       // FNV-1a hash of the content
+        uint16_t length;     // Length of the content
+        uint16_t generation; // Incremented on every change of the content
+    } string;                // TRACKLE_PROP_TYPE_STRING (content is in the string slots of the property)
+    uint64_t raw;            // All the bits of the value, used for comparisons
+} PropValue_t;
+
+// Sample of a series property
+typedef struct
+{
+    uint32_t timeMs; // Time the sample was recorded
+    int32_t value;   // Value of the sample (multiplied by the scale of the property)
+} SeriesSample_t;
+
+// Ring buffer holding the samples of a series property.
+// Samples are written only by Trackle_Prop_addSample and removed only by the properties task, each side updating only its own counter.
+typedef struct
+{
+    volatile uint32_t writeCount; // Number of samples ever recorded
+    volatile uint32_t readCount;  // Number of samples ever removed (because acknowledged by the cloud)
+    uint16_t inFlight;            // Number of the oldest samples serialized in a sync buffer that wasn't acknowledged yet
+    uint16_t serialized;          // Number of samples written by the latest serialization
+    uint16_t capacity;            // Max number of samples in the buffer
+    SeriesSample_t samples[];     // Samples, the i-th recorded one is at index i % capacity
+} SeriesBuffer_t;
+
+// Property metadata, only read when a property is serialized or updated.
+// The state that is scanned every period (values, flags and times) is kept in the dense arrays and bitsets below, indexed by property index.
 typedef struct
 {
     char key[TRACKLE_MAX_PROP_NAME_LENGTH]; // Property name/key
-    bool changed;                           // True if read value is changed
+    uint8_t type;                           // Type of the property (one of Trackle_PropType_t)
     bool sign;                              // True if int32, false if uint32
-    int32_t lastPubValue;                   // Latest read value
-    int32_t setValue;                       // Latest set value
-    uint16_t scale;                         // Scale factor (divides new value when set)
-    bool disabled;                          // If disabled, property is ignored from publish
     uint8_t numDecimals;                    // Number of decimal digits (only used if scale is set)
-    bool setToPublish;                      // True if added to JSON to publish
-    char *lastPubStringValue;               // String value
-    char *setStringValue;                   // If this is not NULL, property is a string property and this is its value
-    int stringValueMaxLength;               // Max length of the string contained in \ref stringValue field
+    uint16_t scale;                         // Scale factor (divides new value when set)
+    uint32_t debounceDelayMs;               // Delay to wait before setting the property to changed
+    char *stringSlots[2];                   // Buffers holding set and last published value of string properties (NULL for the other types)
+    uint8_t setStringSlot;                  // Index of the string slot holding the set value
+    uint8_t pubStringSlot;                  // Index of the string slot holding the last published value (can be the same as setStringSlot)
+    int stringValueMaxLength;               // Max length of the string contained in string slots
+    Trackle_PropValidator_t validator;      // Callback used to accept or reject values written from the cloud (NULL accepts everything)
+    SeriesBuffer_t *series;                 // Samples of series properties (NULL for the other types)
+} Prop_t;
 
-    // Debounce
-    bool debouncing;          // Set to true if a value was set with debouncing
-    uint32_t latestSetTimeMs; // Latest time the property was set
-    uint32_t debounceDelayMs; // Delay to wait before setting the property to changed
+#define BITSET_WORDS(bitsNum) (((bitsNum) + 31) / 32) // Number of 32 bits words needed to store a bitset
+#define PROPS_BITSET_WORDS BITSET_WORDS(TRACKLE_MAX_PROPS_NUM)
 
-} Prop_t;
+#define PROPS_KEY_TABLE_SIZE (2 * TRACKLE_MAX_PROPS_NUM + 1) // Size of the hash table of the keys, kept at most half full to keep probe sequences short
+
+static inline bool bitsetGet(const uint32_t *bitset, int bit)
+{
+    return (bitset[bit >> 5] >> (bit & 31)) & 1;
+}
+
+// Bits of the same word belong to different properties, which can be written by application tasks and by the properties task at the same time,
+// so the word is updated atomically: a plain read-modify-write could undo the concurrent change of another property.
+static inline void bitsetAssign(uint32_t *bitset, int bit, bool value)
+{
+    if (value)
+        __atomic_fetch_or(&bitset[bit >> 5], 1UL << (bit & 31), __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&bitset[bit >> 5], ~(1UL << (bit & 31)), __ATOMIC_RELAXED);
+}
+
+// Returns the first set bit of the bitset starting from bit, or -1 if there is none before bitsNum.
+static inline int bitsetNext(const uint32_t *bitset, int bit, int bitsNum)
+{
+    if (bit >= bitsNum)
+        return -1;
+    int wordIdx = bit >> 5;
+    uint32_t word = bitset[wordIdx] & (UINT32_MAX << (bit & 31));
+    const int wordsNum = BITSET_WORDS(bitsNum);
+    while (word == 0)
+    {
+        if (++wordIdx >= wordsNum)
+            return -1;
+        word = bitset[wordIdx];
+    }
+    const int next = (wordIdx << 5) + __builtin_ctz(word);
+    return next < bitsNum ? next : -1;
+}
 
 // Property group data structure
 typedef struct
 {
-    bool onlyIfChanged;                                   // If true, update the properties within only if their values changed.
-    Trackle_PropID_t propsIndexes[TRACKLE_MAX_PROPS_NUM]; // Indexes (different from IDs) of the properties in the group.
-    int propsWithin;                                      // Number of properties in the group (number of valid elements in propsIndexes)
-    uint32_t periodMs;                                    // Period of publication of the group in milliseconds
-    uint32_t latestWakeTimeMs;                            // Latest time the group's properties were published
+    bool onlyIfChanged;                      // If true, update the properties within only if their values changed.
+    uint32_t propsBits[PROPS_BITSET_WORDS];  // Set if the property with the same index (different from ID) is in the group.
+    int propsWithin;                         // Number of properties in the group (number of set bits in propsBits)
+    uint32_t periodMs;                       // Period of publication of the group in milliseconds
+    uint32_t latestWakeTimeMs;               // Latest time the group's properties were published
+    int resumePropIdx;                       // Index of the first property that didn't fit in the sync buffer, where the publication continues at next iteration (NO_RESUME_PROP if complete)
 } PropGroup_t;
 
 static PropGroup_t propGroups[TRACKLE_MAX_PROPGROUPS_NUM] = {0}; // Array holding the properties groups created by the user.
 static int numPropGroupsCreated = 0;                             // Number of the property groups created (aka next property group ID available)
 
-static Prop_t props[TRACKLE_MAX_PROPS_NUM] = {0}; // Array holding the properties created by the user.
+static Prop_t props[TRACKLE_MAX_PROPS_NUM] = {0}; // Array holding the metadata of the properties created by the user.
 static int numPropsCreated = 0;                   // Number of the properties created (aka next property ID available)
 
+// Hot state of the properties
+static PropValue_t propSetValues[TRACKLE_MAX_PROPS_NUM] = {0};     // Latest set value
+static PropValue_t propLastPubValues[TRACKLE_MAX_PROPS_NUM] = {0}; // Latest read value
+static uint32_t propLatestSetTimesMs[TRACKLE_MAX_PROPS_NUM] = {0}; // Latest time the property was set (for debounce)
+static uint32_t propVersions[TRACKLE_MAX_PROPS_NUM] = {0};         // Version of the synchronization holding the latest serialization of the property (0 if never serialized)
+static int8_t propPendingSyncBuffers[TRACKLE_MAX_PROPS_NUM] = {0}; // Index of the sync buffer holding the latest serialization of the property (NO_SYNC_BUFFER if none)
+static uint32_t propChangedBits[PROPS_BITSET_WORDS] = {0};         // Set if read value is changed
+static uint32_t propDebouncingBits[PROPS_BITSET_WORDS] = {0};      // Set if a value was set and its debounce delay is not elapsed yet
+static uint32_t propDisabledBits[PROPS_BITSET_WORDS] = {0};        // Set if property is disabled (ignored from publish)
+static uint32_t propUrgentBits[PROPS_BITSET_WORDS] = {0};          // Set if a change of the property is published without waiting for the period of its groups
+static uint32_t propStringBits[PROPS_BITSET_WORDS] = {0};          // Set if property is a string property
+static uint32_t propSeriesBits[PROPS_BITSET_WORDS] = {0};          // Set if property is a series property
+static uint32_t propUnsyncedBits[PROPS_BITSET_WORDS] = {0};        // Set until the property is acknowledged by a full synchronization (the first one or a resync)
+static uint32_t propResendBits[PROPS_BITSET_WORDS] = {0};          // Set if the latest serialization of the property failed, so it's dirty even if its value equals the last sent one
+
+static uint16_t propKeyTable[PROPS_KEY_TABLE_SIZE] = {0}; // Hash table of the keys of the properties, holding property IDs (0 if slot is empty)
+
+// Buffer holding a JSON string of properties to be synchronized
+typedef struct
+{
+    char json[JSON_BUFFER_LEN]; // JSON string of the properties
+    bool busy;                  // True from when the buffer is handed to the sender task until its result is processed
+    bool fullSync;              // True if the buffer contains part of the first (full) synchronization of the properties, or of a resync
+    uint32_t baseVersion;       // Version of the synchronization handed to the sender task before this one
+    uint32_t targetVersion;     // Version of this synchronization
+} SyncBuffer_t;
+
+// Result of a synchronization, reported by the sender task to the properties task
+typedef struct
+{
+    int bufferIndex; // Index of the synchronized buffer
+    bool success;    // True if the cloud acknowledged the synchronization
+} SyncResult_t;
+
+static SyncBuffer_t syncBuffers[SYNC_BUFFERS_NUM] = {0}; // Buffers used alternately to build and to transmit synchronizations.
+static QueueHandle_t syncRequestsQueue = NULL;           // Indexes of the buffers to be transmitted by the sender task.
+static QueueHandle_t syncResultsQueue = NULL;            // Results of the transmissions, to be processed by the properties task.
+static bool fullSyncPending = true;                      // True until every property has been added to an acknowledged synchronization
+
+// Versions of the synchronizations, incremented for every synchronization handed to the sender task
+static bool versioningEnabled = false;           // True if the versions are added to the synchronizations
+static uint32_t latestVersion = 0;               // Version of the latest synchronization handed to the sender task
+static uint32_t ackedVersion = 0;                // Version of the latest acknowledged synchronization
+static volatile bool resyncRequested = false;    // True if the cloud asked for the changes since resyncSinceVersion
+static volatile uint32_t resyncSinceVersion = 0; // Latest version received by the cloud, when it asked for a resync
+
+// Compression of the synchronizations, done by the sender task
+static int compressionThreshold = 0;                                  // Min length of the synchronizations to be compressed (0 if compression is disabled)
+static Trackle_CompressionWorkspace_t compressionWorkspace;           // Memory used by the compressor
+static uint8_t compressedJson[JSON_BUFFER_LEN];                       // Compressed stream of a synchronization
+static char compressedJsonEnvelope[COMPRESSED_JSON_BUFFER_LEN] = {0}; // Compressed stream in base64, wrapped in a JSON object
+
+static TaskHandle_t propertiesTaskHandle = NULL;                            // Handle of the properties task, notified on updates of urgent properties.
+static volatile bool urgentFlushRequested = false;                          // True if an urgent property was updated and must be flushed
+static uint32_t latestUrgentFlushMs = 0;                                    // Latest time a flush of urgent properties was done
+static uint32_t urgentMinIntervalMs = URGENT_FLUSH_DEFAULT_MIN_INTERVAL_MS; // Minimum time between two flushes of urgent properties
+
+static uint32_t minPeriodMs = TRACKLE_PROPERTIES_TASK_PERIOD_MS;     // Period of the properties task while properties are changing
+static uint32_t maxPeriodMs = TRACKLE_PROPERTIES_TASK_PERIOD_MS;     // Max period of the properties task while nothing changes
+static uint32_t currentPeriodMs = TRACKLE_PROPERTIES_TASK_PERIOD_MS; // Period of the properties task, doubled at every idle iteration up to maxPeriodMs
+static volatile bool changedSinceTick = false;                       // True if a property was updated since the latest iteration
+
 static int32_t defaultValue = 0;   //  Default value of a new property
 static bool defaultChanged = true; // Default changed value of a property
 
@@ -70,7 +222,9 @@ Trackle_PropGroupID_t Trackle_PropGroup_create(uint32_t periodMs, bool onlyIfCha
         propGroups[newPropGroupIndex].latestWakeTimeMs = 0; // 0 is not significant here, it must be updated on task start with current time
         propGroups[newPropGroupIndex].onlyIfChanged = onlyIfChanged;
         propGroups[newPropGroupIndex].propsWithin = 0;
+        memset(propGroups[newPropGroupIndex].propsBits, 0, sizeof(propGroups[newPropGroupIndex].propsBits));
         propGroups[newPropGroupIndex].periodMs = periodMs;
+        propGroups[newPropGroupIndex].resumePropIdx = NO_RESUME_PROP;
         numPropGroupsCreated++;
         return newPropGroupIndex + 1; // Convert internal property group index to property group ID by incrementing it.
     }
@@ -81,337 +235,1218 @@ bool Trackle_PropGroup_addProp(Trackle_PropID_t propId, Trackle_PropGroupID_t pr
 {
     const int propIndex = propId - 1;           // Convert property ID to internal property index by decrementing it.
     const int propGroupIndex = propGroupId - 1; // Convert property group ID to internal property group index by decrementing it.
-    if (propGroupIndex >= 0 && propGroupIndex < numPropGroupsCreated && propIndex < numPropsCreated && propIndex >= 0 && propGroups[propGroupId].propsWithin < TRACKLE_MAX_PROPS_NUM - 1)
+    if (propGroupIndex >= 0 && propGroupIndex < numPropGroupsCreated && propIndex < numPropsCreated && propIndex >= 0)
     {
-        const int propsWithin = propGroups[propGroupIndex].propsWithin;
-        for (int i = 0; i < propsWithin; i++)
+        if (bitsetGet(propGroups[propGroupIndex].propsBits, propIndex))
         {
-            if (propGroups[propGroupIndex].propsIndexes[i] == propIndex)
-            {
-                return false; // Fail, property already in this group
-            }
+            return false; // Fail, property already in this group
         }
-        propGroups[propGroupIndex].propsIndexes[propsWithin] = propIndex;
+        bitsetAssign(propGroups[propGroupIndex].propsBits, propIndex, true);
         propGroups[propGroupIndex].propsWithin++;
         return true;
     }
     return false;
 }
 
-static char *lastCharPtr(char *s)
+#define SWAR_ONES 0x01010101UL  // 0x01 in every byte of a word
+#define SWAR_HIGHS 0x80808080UL // 0x80 in every byte of a word
+
+// True if any byte of the word is a quote, a backslash or a control character, which must be escaped in JSON strings.
+// (x - 0x01..) & ~x has the high bit set in the bytes of x lower than 1, and possibly in bytes above them, so the whole word is tested exactly.
+static inline bool wordNeedsJsonEscape(uint32_t word)
+{
+    const uint32_t quotes = word ^ (SWAR_ONES * '"');         // Zero bytes where word has quotes
+    const uint32_t backslashes = word ^ (SWAR_ONES * '\\'); // Zero bytes where word has backslashes
+    const uint32_t controls = (word - SWAR_ONES * 0x20) & ~word;
+    const uint32_t matches = ((quotes - SWAR_ONES) & ~quotes) | ((backslashes - SWAR_ONES) & ~backslashes);
+    return ((controls | matches) & SWAR_HIGHS) != 0;
+}
+
+static inline bool charNeedsJsonEscape(char c)
 {
-    return &(s[strlen(s)]);
+    return (uint8_t)c < 0x20 || c == '"' || c == '\\';
 }
 
-static void appendPropertyToJsonString(char *jsonBuffer, int propIndex)
+// Returns the index of the first char of str, starting from start, that must be escaped, or length if there is none.
+// Chars are checked a word at a time, falling back to single chars only for the tail and for the word containing the match.
+static int findJsonEscape(const char *str, int start, int length)
 {
-    char *jsonBufferTail = lastCharPtr(jsonBuffer);
-    if (strlen(jsonBuffer) > 1)
+    int i = start;
+    for (; i + (int)sizeof(uint32_t) <= length; i += sizeof(uint32_t))
     {
-        jsonBufferTail += sprintf(jsonBufferTail, ",");
-    }
-    if (props[propIndex].setStringValue != NULL)
-    { // string
-        jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":\"%s\"", props[propIndex].key, props[propIndex].setStringValue);
-    }
-    else if (props[propIndex].scale == 1)
-    { // integer
-        if (props[propIndex].sign)
-        { // uint, remove sign
-            jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":%" PRIu32, props[propIndex].key, (uint32_t)props[propIndex].setValue);
-        }
-        else
+        uint32_t word;
+        memcpy(&word, &str[i], sizeof(word)); // String may be unaligned
+        if (wordNeedsJsonEscape(word))
         {
-            jsonBufferTail += sprintf(jsonBufferTail, "\"%s\":%" PRIi32, props[propIndex].key, props[propIndex].setValue);
+            break;
         }
     }
-    else
-    { // double
-        char strFormat[20];
-        sprintf(strFormat, "\"%%s\":%%.%df", (int)(props[propIndex].numDecimals));
-        jsonBufferTail += sprintf(jsonBufferTail, strFormat, props[propIndex].key, ((double)props[propIndex].setValue) / props[propIndex].scale);
+    while (i < length && !charNeedsJsonEscape(str[i]))
+    {
+        i++;
     }
+    return i;
 }
 
-static bool isSetValueEqualToLastSent(int propIndex)
+// Copy n chars to dst at *pos if they fit before the last char of dst, advancing *pos anyway to account for the full length.
+static inline void putChars(char *dst, int size, int *pos, const char *chars, int n)
 {
-    if (props[propIndex].setStringValue != NULL)
+    if (*pos + n < size)
     {
-        // This is a string-property
-        return strcmp(props[propIndex].setStringValue, props[propIndex].lastPubStringValue) == 0;
+        memcpy(&dst[*pos], chars, n);
     }
-    return props[propIndex].setValue == props[propIndex].lastPubValue;
+    *pos += n;
 }
 
-static void updateLastSentToSetValue(int propIndex)
+// Write the first length chars of str as a quoted JSON string, escaping quotes, backslashes and control characters.
+// Same return value as snprintf: the length of the escaped string, even if it doesn't fit in size.
+static int writeJsonString(char *dst, int size, const char *str, int length)
 {
-    if (props[propIndex].setStringValue != NULL)
-        strcpy(props[propIndex].lastPubStringValue, props[propIndex].setStringValue);
-    else
-        props[propIndex].lastPubValue = props[propIndex].setValue;
+    int pos = 0;
+    putChars(dst, size, &pos, "\"", 1);
+    int i = 0;
+    while (i < length)
+    {
+        const int escapeIdx = findJsonEscape(str, i, length);
+        putChars(dst, size, &pos, &str[i], escapeIdx - i); // Clean chars are copied as they are
+        if (escapeIdx == length)
+        {
+            break;
+        }
+        char escaped[7];
+        switch (str[escapeIdx])
+        {
+        case '"':
+            memcpy(escaped, "\\\"", 3);
+            break;
+        case '\\':
+            memcpy(escaped, "\\\\", 3);
+            break;
+        case '\b':
+            memcpy(escaped, "\\b", 3);
+            break;
+        case '\f':
+            memcpy(escaped, "\\f", 3);
+            break;
+        case '\n':
+            memcpy(escaped, "\\n", 3);
+            break;
+        case '\r':
+            memcpy(escaped, "\\r", 3);
+            break;
+        case '\t':
+            memcpy(escaped, "\\t", 3);
+            break;
+        default:
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (uint8_t)str[escapeIdx]);
+            break;
+        }
+        putChars(dst, size, &pos, escaped, strlen(escaped));
+        i = escapeIdx + 1;
+    }
+    putChars(dst, size, &pos, "\"", 1);
+    if (size > 0)
+    {
+        dst[pos < size ? pos : size - 1] = '\0';
+    }
+    return pos;
 }
 
-static bool isMsElapsed(uint32_t now, uint32_t start, uint32_t delay)
+// Write a value scaled according to the property, with the same return value as snprintf.
+static int formatScaledValue(char *dst, int size, const Prop_t *prop, int32_t value)
 {
-    if (now < start)
-        return (now + UINT32_MAX - start + 1) >= delay;
-    return now - start >= delay;
+    if (prop->scale != 1)
+    { // double
+        return snprintf(dst, size, "%.*f", (int)prop->numDecimals, ((double)value) / prop->scale);
+    }
+    if (prop->sign)
+    { // uint, remove sign
+        return snprintf(dst, size, "%" PRIu32, (uint32_t)value);
+    }
+    return snprintf(dst, size, "%" PRIi32, value);
 }
 
-static void tracklePropertiesTaskCode(void *arg)
+// Write the samples of a series property that are not in a sync buffer yet, as many as fit, with the same return value as snprintf.
+// The number of samples written is stored in the serialized field of the series, so that they are marked as in flight if the property is added to the JSON string.
+static int formatSeriesValue(char *dst, int size, const Prop_t *prop)
 {
+    SeriesBuffer_t *series = prop->series;
+    const uint32_t first = series->readCount + series->inFlight;
+    const uint32_t available = series->writeCount - first;
+    const SeriesSample_t *firstSample = &series->samples[first % series->capacity];
+    const uint32_t nowMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
 
-    static char jsonBuffer[JSON_BUFFER_LEN];
-    jsonBuffer[0] = '\0';
-
-    TickType_t latestWakeTime = xTaskGetTickCount();
-    bool first_run = true;
+    // Count the samples that fit, measuring their times and values
+    const char *separator = "],\"v\":[";
+    int length = snprintf(NULL, 0, "{\"age\":%" PRIu32 ",\"dt\":[", nowMs - firstSample->timeMs) + strlen(separator) + strlen("]}");
+    uint32_t fitting = 0;
+    uint32_t prevTimeMs = firstSample->timeMs;
+    while (fitting < available)
+    {
+        const SeriesSample_t *sample = &series->samples[(first + fitting) % series->capacity];
+        int sampleLength = formatScaledValue(NULL, 0, prop, sample->value);
+        if (fitting > 0)
+        {
+            sampleLength += snprintf(NULL, 0, "%" PRIu32, sample->timeMs - prevTimeMs) + 2; // +2 for the commas of both arrays
+        }
+        if (length + sampleLength >= size)
+        {
+            break;
+        }
+        length += sampleLength;
+        prevTimeMs = sample->timeMs;
+        fitting++;
+    }
+    series->serialized = fitting;
+    if (fitting == 0)
+    {
+        return size; // Not even a sample fits
+    }
 
-    // Consider this instant as 0 in the time of the properties
-    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    int written = snprintf(dst, size, "{\"age\":%" PRIu32 ",\"dt\":[", nowMs - firstSample->timeMs);
+    for (uint32_t i = 1; i < fitting; i++)
     {
-        propGroups[pgIdx].latestWakeTimeMs = latestWakeTime * portTICK_PERIOD_MS;
+        const uint32_t dt = series->samples[(first + i) % series->capacity].timeMs - series->samples[(first + i - 1) % series->capacity].timeMs;
+        written += snprintf(dst + written, size - written, i > 1 ? ",%" PRIu32 : "%" PRIu32, dt);
     }
+    written += snprintf(dst + written, size - written, "%s", separator);
+    for (uint32_t i = 0; i < fitting; i++)
+    {
+        if (i > 0)
+        {
+            dst[written++] = ',';
+        }
+        written += formatScaledValue(dst + written, size - written, prop, series->samples[(first + i) % series->capacity].value);
+    }
+    written += snprintf(dst + written, size - written, "]}");
+    return written;
+}
 
-    for (;;)
+// Write the JSON representation of the value of the property, with the same return value as snprintf.
+static int formatPropValue(char *dst, int size, int propIndex)
+{
+    const Prop_t *prop = &props[propIndex];
+    switch (prop->type)
     {
-        bool propsToPublish = false;
+    case TRACKLE_PROP_TYPE_STRING:
+        return writeJsonString(dst, size, prop->stringSlots[prop->setStringSlot], propSetValues[propIndex].string.length);
+    case TRACKLE_PROP_TYPE_BOOL:
+        return snprintf(dst, size, "%s", propSetValues[propIndex].boolean ? "true" : "false");
+    case TRACKLE_PROP_TYPE_INT64:
+        return snprintf(dst, size, "%" PRIi64, propSetValues[propIndex].int64);
+    case TRACKLE_PROP_TYPE_UINT64:
+        return snprintf(dst, size, "%" PRIu64, propSetValues[propIndex].uint64);
+    case TRACKLE_PROP_TYPE_FLOAT:
+        return snprintf(dst, size, "%.*f", (int)prop->numDecimals, (double)propSetValues[propIndex].real);
+    case TRACKLE_PROP_TYPE_SERIES:
+        return formatSeriesValue(dst, size, prop);
+    default:
+        return formatScaledValue(dst, size, prop, propSetValues[propIndex].fixed);
+    }
+}
 
-        vTaskDelayUntil(&latestWakeTime, TRACKLE_PROPERTIES_TASK_PERIOD_MS / portTICK_PERIOD_MS);
-        const uint32_t nowMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+// Append the property to the JSON string, keeping room for the closing brace.
+// Returns false, leaving the JSON string untouched, if the property doesn't fit in the buffer.
+static bool appendPropertyToJsonString(char *jsonBuffer, int propIndex)
+{
+    const int jsonLen = strlen(jsonBuffer);
+    char *jsonBufferTail = &jsonBuffer[jsonLen];
+    const int available = JSON_BUFFER_LEN - 1 - (versioningEnabled ? VERSION_MEMBER_MAX_LEN : 0) - jsonLen; // -1 for closing brace
+    int written = jsonLen > 1 ? snprintf(jsonBufferTail, available, ",") : 0;
+    if (written < available)
+    {
+        written += writeJsonString(jsonBufferTail + written, available - written, props[propIndex].key, strlen(props[propIndex].key));
+    }
+    if (written < available)
+    {
+        written += snprintf(jsonBufferTail + written, available - written, ":");
+    }
+    if (written < available)
+    {
+        written += formatPropValue(jsonBufferTail + written, available - written, propIndex);
+    }
+    if (written >= available)
+    {
+        *jsonBufferTail = '\0';
+        return false;
+    }
+    return true;
+}
 
-        if (trackleConnected(trackle_s))
-        {
-            // For each group...
-            for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
-            {
+static bool isSetValueEqualToLastSent(int propIndex)
+{
+    if (bitsetGet(propSeriesBits, propIndex))
+    {
+        // Series properties are unchanged until they have samples that were never serialized.
+        const SeriesBuffer_t *series = props[propIndex].series;
+        return series->writeCount == series->readCount + series->inFlight;
+    }
+    // Values are zeroed on creation and every property only writes the member of its type, so the whole union can be compared.
+    // For string properties this compares hash, length and generation, which are all equal if the string wasn't changed since publication.
+    if (propSetValues[propIndex].raw == propLastPubValues[propIndex].raw)
+    {
+        return true;
+    }
+    if (!bitsetGet(propStringBits, propIndex) ||
+        propSetValues[propIndex].string.hash != propLastPubValues[propIndex].string.hash ||
+        propSetValues[propIndex].string.length != propLastPubValues[propIndex].string.length)
+    {
+        return false;
+    }
+    // Changed and then changed back to the published content
+    const Prop_t *prop = &props[propIndex];
+    return memcmp(prop->stringSlots[prop->setStringSlot], prop->stringSlots[prop->pubStringSlot], propSetValues[propIndex].string.length) == 0;
+}
 
-                const int propsWithin = propGroups[pgIdx].propsWithin;
-                const bool onlyIfChanged = propGroups[pgIdx].onlyIfChanged;
+static void updateLastSentToSetValue(int propIndex)
+{
+    if (bitsetGet(propStringBits, propIndex))
+    {
+        // The set value becomes the published one without copying it: next update will write to the other slot.
+        props[propIndex].pubStringSlot = props[propIndex].setStringSlot;
+    }
+    propLastPubValues[propIndex] = propSetValues[propIndex];
+}
 
-                // ... if its period is elapsed ...
-                if (isMsElapsed(nowMs, propGroups[pgIdx].latestWakeTimeMs, propGroups[pgIdx].periodMs) || first_run)
-                {
+// FNV-1a hash of the first length chars of str
+static uint32_t hashString(const char *str, int length)
+{
+    uint32_t hash = 2166136261UL;
+    for (int i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
 
-                    propGroups[pgIdx].latestWakeTimeMs = nowMs;
+// Returns the slot of the key table holding the key, or the empty slot where it should be inserted.
+static int findKeyTableSlot(const char *key)
+{
+    int slot = hashString(key, strlen(key)) % PROPS_KEY_TABLE_SIZE;
+    while (propKeyTable[slot] != 0 && strcmp(key, props[propKeyTable[slot] - 1].key) != 0)
+    {
+        slot = (slot + 1) % PROPS_KEY_TABLE_SIZE; // Linear probing, properties are never removed
+    }
+    return slot;
+}
 
-                    // ... for each property in the group ...
-                    for (int i = 0; i < propsWithin; i++)
-                    {
-                        const int propIdx = propGroups[pgIdx].propsIndexes[i];
+static int findPropIndexByKey(const char *key)
+{
+    return propKeyTable[findKeyTableSlot(key)] - 1; // -1 if slot is empty
+}
 
-                        if (props[propIdx].debouncing && isMsElapsed(nowMs, props[propIdx].latestSetTimeMs, props[propIdx].debounceDelayMs))
-                        {
-                            props[propIdx].debouncing = false;
-                            props[propIdx].changed = true;
-                        }
+static bool isMsElapsed(uint32_t now, uint32_t start, uint32_t delay)
+{
+    if (now < start)
+        return (now + UINT32_MAX - start + 1) >= delay;
+    return now - start >= delay;
+}
 
-                        // ... if it's changed or it must be published anyway ...
-                        if (!props[propIdx].disabled && ((props[propIdx].changed && !isSetValueEqualToLastSent(propIdx)) || !onlyIfChanged || first_run))
-                        {
-                            // ... add it to JSON string to publish.
-                            if (!propsToPublish)
-                            {
-                                propsToPublish = true;
-                                strcat(jsonBuffer, "{");
-                            }
-                            appendPropertyToJsonString(jsonBuffer, propIdx);
-                            props[propIdx].setToPublish = true;
-                            updateLastSentToSetValue(propIdx);
-                        }
-                    }
-                }
+// Handle the results reported by the sender task: properties serialized in an acknowledged buffer are no longer changed.
+static void processSyncResults()
+{
+    SyncResult_t result;
+    while (xQueueReceive(syncResultsQueue, &result, 0) == pdTRUE)
+    {
+        SyncBuffer_t *syncBuffer = &syncBuffers[result.bufferIndex];
+        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        {
+            // The last sent value is updated on serialization, so a property whose latest serialization failed must be sent again.
+            // Its pending buffer may have been reset by a newer change in the meanwhile, so it's recognized by the version of the buffer.
+            if (!result.success && propVersions[pIdx] == syncBuffer->targetVersion && !bitsetGet(propSeriesBits, pIdx))
+            {
+                bitsetAssign(propResendBits, pIdx, true);
             }
-
-            // If there is at least a property in the JSON string to publish, publish it.
-            if (propsToPublish)
+            if (propPendingSyncBuffers[pIdx] == result.bufferIndex)
             {
-                strcat(jsonBuffer, "}");
-                bool publishedSuccessfully = trackleSyncStateSecure(jsonBuffer);
-                if (publishedSuccessfully)
+                if (bitsetGet(propSeriesBits, pIdx))
                 {
-                    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+                    // Acknowledged samples are removed, the others are serialized again. Series properties are always changed.
+                    SeriesBuffer_t *series = props[pIdx].series;
+                    if (result.success)
                     {
-                        if (props[pIdx].setToPublish)
-                        {
-                            props[pIdx].changed = false;
-                        }
+                        series->readCount += series->inFlight;
                     }
-                    first_run = false;
+                    series->inFlight = 0;
+                }
+                else if (result.success)
+                {
+                    bitsetAssign(propChangedBits, pIdx, false);
                 }
-                for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+                if (result.success)
                 {
-                    props[pIdx].setToPublish = false;
+                    bitsetAssign(propUnsyncedBits, pIdx, false);
                 }
-                jsonBuffer[0] = '\0';
+                propPendingSyncBuffers[pIdx] = NO_SYNC_BUFFER;
             }
         }
+        if (result.success && syncBuffer->targetVersion > ackedVersion)
+        {
+            ackedVersion = syncBuffer->targetVersion;
+        }
+        if (!result.success && syncBuffer->fullSync)
+        {
+            fullSyncPending = true; // Part of the first synchronization failed, repeat it for the properties that are still unsynced
+        }
+        syncBuffer->json[0] = '\0';
+        syncBuffer->busy = false;
     }
 }
 
-bool Trackle_Props_startTask()
+static int getFreeSyncBufferIndex()
 {
+    for (int bIdx = 0; bIdx < SYNC_BUFFERS_NUM; bIdx++)
+    {
+        if (!syncBuffers[bIdx].busy)
+        {
+            return bIdx;
+        }
+    }
+    return NO_SYNC_BUFFER;
+}
 
-    ESP_LOGI(TAG, "Initializing...");
-
-    // Task creation
-    BaseType_t taskCreationRes;
-
-    taskCreationRes = xTaskCreatePinnedToCore(tracklePropertiesTaskCode,
-                                              TRACKLE_PROPERTIES_TASK_NAME,
-                                              TRACKLE_PROPERTIES_TASK_STACK_SIZE,
-                                              NULL,
-                                              TRACKLE_PROPERTIES_TASK_PRIORITY,
-                                              NULL,
-                                              TRACKLE_PROPERTIES_TASK_CORE_ID);
+static void updateDebounce(int propIdx, uint32_t nowMs)
+{
+    if (bitsetGet(propDebouncingBits, propIdx) && isMsElapsed(nowMs, propLatestSetTimesMs[propIdx], props[propIdx].debounceDelayMs))
+    {
+        bitsetAssign(propDebouncingBits, propIdx, false);
+        bitsetAssign(propChangedBits, propIdx, true);
+        propPendingSyncBuffers[propIdx] = NO_SYNC_BUFFER; // Acknowledge of an older value must not clear this change
+    }
+}
 
-    if (taskCreationRes == pdTRUE)
+// Series properties are added only if they have new samples and none waiting for acknowledgement, the others only if not in this buffer yet.
+static bool canAddPropToSyncBuffer(int bufIdx, int propIdx)
+{
+    if (bitsetGet(propSeriesBits, propIdx))
     {
-        ESP_LOGI(TAG, "Task created successfully.");
-        return true;
+        return propPendingSyncBuffers[propIdx] == NO_SYNC_BUFFER && !isSetValueEqualToLastSent(propIdx);
     }
-    ESP_LOGE(TAG, "Error in task creation.");
-    return false;
+    return propPendingSyncBuffers[propIdx] != bufIdx;
 }
 
-int Trackle_Props_getNumber()
+static bool isPropDirty(int propIdx)
 {
-    return numPropsCreated;
+    return !bitsetGet(propDisabledBits, propIdx) && bitsetGet(propChangedBits, propIdx) && (bitsetGet(propResendBits, propIdx) || !isSetValueEqualToLastSent(propIdx));
 }
 
-Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t numDecimals, bool sign)
+// Add the property to the JSON string of the sync buffer. Returns false if it doesn't fit.
+static bool addPropToSyncBuffer(int bufIdx, int propIdx)
 {
-    if (numPropsCreated < TRACKLE_MAX_PROPS_NUM)
+    char *jsonBuffer = syncBuffers[bufIdx].json;
+    if (jsonBuffer[0] == '\0')
     {
-        const int newPropIndex = numPropsCreated;
-        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        strcpy(jsonBuffer, "{");
+    }
+    if (!appendPropertyToJsonString(jsonBuffer, propIdx))
+    {
+        if (jsonBuffer[1] != '\0')
         {
-            if (strcmp(name, props[pIdx].key) == 0)
-            {
-                return Trackle_PropID_ERROR;
-            }
+            ESP_LOGD(TAG, "No room left for %s, it will be published later", props[propIdx].key);
         }
-        if (strlen(name) < TRACKLE_MAX_PROP_NAME_LENGTH)
+        else if (bitsetGet(propChangedBits, propIdx))
         {
-            strcpy(props[newPropIndex].key, name);
+            // E.g. a string full of chars to be escaped: drop the change, so that it isn't retried (and logged) at every iteration
+            ESP_LOGE(TAG, "%s doesn't fit in an empty sync buffer, its value can't be published", props[propIdx].key);
+            bitsetAssign(propChangedBits, propIdx, false);
         }
-        else
-        {
-            return Trackle_PropID_ERROR;
-        }
-        props[newPropIndex].lastPubValue = defaultValue;
-        props[newPropIndex].setValue = defaultValue;
-        props[newPropIndex].scale = scale;
-        props[newPropIndex].sign = sign;
-        props[newPropIndex].numDecimals = numDecimals;
-        props[newPropIndex].disabled = false;
-        props[newPropIndex].changed = defaultChanged;
-        props[newPropIndex].setToPublish = false;
-        props[newPropIndex].lastPubStringValue = NULL;
-        props[newPropIndex].setStringValue = NULL;
-        props[newPropIndex].stringValueMaxLength = 0;
-        props[newPropIndex].debouncing = false;
-        props[newPropIndex].latestSetTimeMs = 0;
-        props[newPropIndex].debounceDelayMs = 0;
-        numPropsCreated++;
-        return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+        return false;
     }
-    return Trackle_PropID_ERROR;
+    propPendingSyncBuffers[propIdx] = bufIdx;
+    propVersions[propIdx] = latestVersion + 1; // A buffer with properties is handed to the sender task in the same iteration, with the next version
+    bitsetAssign(propResendBits, propIdx, false);
+    if (bitsetGet(propSeriesBits, propIdx))
+    {
+        props[propIdx].series->inFlight = props[propIdx].series->serialized;
+    }
+    updateLastSentToSetValue(propIdx);
+    return true;
 }
 
-Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength)
+// Add to the sync buffer the changed urgent properties, followed by any other changed property that fits.
+// Returns the number of properties added. Sets complete to false if some urgent property is still debouncing.
+static int addUrgentPropsToSyncBuffer(int bufIdx, uint32_t nowMs, bool *complete)
 {
-    if (numPropsCreated < TRACKLE_MAX_PROPS_NUM)
+    int added = 0;
+    *complete = true;
+    for (int pass = 0; pass < 2; pass++) // First pass for urgent properties, second one for the others
     {
-        const int newPropIndex = numPropsCreated;
-        for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
+        for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
         {
-            if (strcmp(name, props[pIdx].key) == 0)
+            const uint32_t *propsBits = propGroups[pgIdx].propsBits;
+            for (int propIdx = bitsetNext(propsBits, 0, numPropsCreated); propIdx >= 0; propIdx = bitsetNext(propsBits, propIdx + 1, numPropsCreated))
             {
-                return Trackle_PropID_ERROR;
+                if (bitsetGet(propUrgentBits, propIdx) != (pass == 0))
+                {
+                    continue;
+                }
+                updateDebounce(propIdx, nowMs);
+                if (pass == 0 && bitsetGet(propDebouncingBits, propIdx))
+                {
+                    *complete = false;
+                }
+                if (canAddPropToSyncBuffer(bufIdx, propIdx) && isPropDirty(propIdx) && addPropToSyncBuffer(bufIdx, propIdx))
+                {
+                    added++;
+                }
             }
         }
-        if (strlen(name) < TRACKLE_MAX_PROP_NAME_LENGTH)
-        {
-            strcpy(props[newPropIndex].key, name);
-        }
-        else
-        {
-            return Trackle_PropID_ERROR;
-        }
-        props[newPropIndex].lastPubValue = defaultValue;
-        props[newPropIndex].setValue = defaultValue;
-        props[newPropIndex].scale = 1;
-        props[newPropIndex].sign = 0;
-        props[newPropIndex].numDecimals = 0;
-        props[newPropIndex].disabled = false;
-        props[newPropIndex].changed = defaultChanged;
-        props[newPropIndex].setToPublish = false;
-        props[newPropIndex].lastPubStringValue = malloc(maxLength * sizeof(char) + 1); // +1 for null character
-        if (props[newPropIndex].lastPubStringValue == NULL)
-            return Trackle_PropID_ERROR;
-        props[newPropIndex].lastPubStringValue[0] = '\0';
-        props[newPropIndex].setStringValue = malloc(maxLength * sizeof(char) + 1); // +1 for null character
-        if (props[newPropIndex].setStringValue == NULL)
-            return Trackle_PropID_ERROR;
-        props[newPropIndex].setStringValue[0] = '\0';
-        props[newPropIndex].stringValueMaxLength = maxLength;
-        props[newPropIndex].debouncing = false;
-        props[newPropIndex].latestSetTimeMs = 0;
-        props[newPropIndex].debounceDelayMs = 0;
-        numPropsCreated++;
-        return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
     }
-    return Trackle_PropID_ERROR;
+    return added;
 }
 
-bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue)
+// Start a full synchronization of the properties serialized after the version received by the cloud, or of every property if the version is unknown.
+static void processResyncRequest()
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    if (!resyncRequested)
+    {
+        return;
+    }
+    resyncRequested = false;
+    const uint32_t sinceVersion = resyncSinceVersion;
+    const bool unknownVersion = sinceVersion > latestVersion; // E.g. a version preceding a reboot
+    int numResynced = 0;
+    for (int pIdx = 0; pIdx < numPropsCreated; pIdx++)
     {
-        if (props[propIndex].setValue != newValue)
+        if (unknownVersion || propVersions[pIdx] > sinceVersion)
         {
-            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIi32 ", new: %d", props[propIndex].key, props[propIndex].setValue, newValue);
-            props[propIndex].debouncing = true;
-            props[propIndex].latestSetTimeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            props[propIndex].setValue = newValue;
-            return true;
+            bitsetAssign(propUnsyncedBits, pIdx, true);
+            numResynced++;
         }
     }
-    return false;
+    ESP_LOGI(TAG, "Resync since version %" PRIu32 " of %d properties", sinceVersion, numResynced);
+    if (numResynced > 0)
+    {
+        fullSyncPending = true;
+    }
 }
 
-bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue)
+// True if a change or a synchronization is waiting to be published.
+static bool arePropsWaitingToBePublished()
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    if (fullSyncPending || resyncRequested)
+    {
+        return true;
+    }
+    for (int w = 0; w < BITSET_WORDS(numPropsCreated); w++)
     {
-        if (props[propIndex].setStringValue != NULL && newValue != NULL && strcmp(props[propIndex].setStringValue, newValue) != 0)
+        if (((propChangedBits[w] | propDebouncingBits[w]) & ~propDisabledBits[w]) != 0)
         {
-            ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %s, new: %s", props[propIndex].key, props[propIndex].setStringValue, newValue);
-            props[propIndex].debouncing = true;
-            props[propIndex].latestSetTimeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            strncpy(props[propIndex].setStringValue, newValue, props[propIndex].stringValueMaxLength);
-            props[propIndex].setStringValue[props[propIndex].stringValueMaxLength] = '\0';
             return true;
         }
     }
     return false;
 }
 
-bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled)
+// True if something is going on that needs the properties task to run at its min period.
+// While disconnected, nothing can be published: the task runs at its min period only if something is waiting to be published,
+// to notice the reconnection in time, as there is no notification for it.
+static bool isPropsActivityPending(bool connected)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    for (int bIdx = 0; bIdx < SYNC_BUFFERS_NUM; bIdx++)
     {
-        props[propIndex].disabled = isDisabled;
-        return true;
+        if (syncBuffers[bIdx].busy)
+        {
+            return true; // Waiting for the result of a synchronization
+        }
     }
-    return false;
+    if (!connected)
+    {
+        return arePropsWaitingToBePublished();
+    }
+    // Debouncing properties aren't activity: their debounce is resolved only when their group is due, and updatePeriod never waits
+    // past that, while urgent ones keep urgentFlushRequested set until their debounce ends.
+    return urgentFlushRequested || resyncRequested;
 }
 
-bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs)
+// Update the period of the task, snapping it to the min on activity and doubling it otherwise,
+// and return the delay to the next iteration, never later than the next group publication while connected.
+static uint32_t updatePeriod(uint32_t nowMs, bool active, bool connected)
+{
+    if (active)
+    {
+        currentPeriodMs = minPeriodMs;
+    }
+    else if (currentPeriodMs < maxPeriodMs)
+    {
+        currentPeriodMs = currentPeriodMs <= maxPeriodMs / 2 ? currentPeriodMs * 2 : maxPeriodMs;
+    }
+    uint32_t delayMs = currentPeriodMs;
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated && delayMs > minPeriodMs && connected; pgIdx++) // Deadlines of groups don't advance while disconnected
+    {
+        const uint32_t elapsedMs = nowMs - propGroups[pgIdx].latestWakeTimeMs;
+        const uint32_t remainingMs = elapsedMs < propGroups[pgIdx].periodMs ? propGroups[pgIdx].periodMs - elapsedMs : 0;
+        if (remainingMs < delayMs)
+        {
+            delayMs = remainingMs > minPeriodMs ? remainingMs : minPeriodMs;
+        }
+    }
+    return delayMs;
+}
+
+uint32_t tracklePropertiesTick(uint32_t nowMs, bool connected)
+{
+    processSyncResults();
+    processResyncRequest();
+
+    bool active = __atomic_exchange_n(&changedSinceTick, false, __ATOMIC_RELAXED); // An update between a read and a clear would be lost
+
+    // If both buffers are in use by the sender, changes keep accumulating until one of them is released.
+    const int bufIdx = getFreeSyncBufferIndex();
+
+    if (bufIdx != NO_SYNC_BUFFER && connected)
+    {
+        const bool fullSync = fullSyncPending;
+        int deferred = 0; // Number of properties to be published that didn't fit in the buffer
+
+        // For each group...
+        for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+        {
+
+            const uint32_t *propsBits = propGroups[pgIdx].propsBits;
+            const bool onlyIfChanged = propGroups[pgIdx].onlyIfChanged;
+
+            // ... if its period is elapsed, or its latest publication didn't fit in a buffer (a full sync always starts from the first property) ...
+            const bool resuming = propGroups[pgIdx].resumePropIdx != NO_RESUME_PROP;
+            const bool due = !resuming && isMsElapsed(nowMs, propGroups[pgIdx].latestWakeTimeMs, propGroups[pgIdx].periodMs);
+            if (resuming || due || fullSync)
+            {
+
+                const int startPropIdx = resuming && !fullSync ? propGroups[pgIdx].resumePropIdx : 0;
+                if (due)
+                {
+                    propGroups[pgIdx].latestWakeTimeMs = nowMs; // New publication: a full sync alone doesn't postpone the next one
+                }
+                propGroups[pgIdx].resumePropIdx = NO_RESUME_PROP;
+                const bool periodic = !onlyIfChanged && (!fullSync || due); // Every enabled property is published
+
+                // ... for each property in the group ...
+                for (int propIdx = bitsetNext(propsBits, startPropIdx, numPropsCreated); propIdx >= 0; propIdx = bitsetNext(propsBits, propIdx + 1, numPropsCreated))
+                {
+                    updateDebounce(propIdx, nowMs);
+
+                    // ... if it's changed or it must be published anyway (a full sync adds the never synchronized properties, once, until acknowledged) ...
+                    const bool publishAnyway = periodic || (fullSync && bitsetGet(propUnsyncedBits, propIdx) && propPendingSyncBuffers[propIdx] == NO_SYNC_BUFFER);
+                    if (canAddPropToSyncBuffer(bufIdx, propIdx) && (isPropDirty(propIdx) || (!bitsetGet(propDisabledBits, propIdx) && publishAnyway)))
+                    {
+                        // ... add it to JSON string to publish, or resume from it at next iteration if it doesn't fit.
+                        if (!addPropToSyncBuffer(bufIdx, propIdx) && syncBuffers[bufIdx].json[1] != '\0')
+                        {
+                            if (propGroups[pgIdx].resumePropIdx == NO_RESUME_PROP)
+                            {
+                                propGroups[pgIdx].resumePropIdx = propIdx;
+                            }
+                            deferred++;
+                        }
+                    }
+                }
+            }
+        }
+
+        // If an urgent property changed, flush it now (at most once every urgentMinIntervalMs).
+        // The request is cleared before looking for the urgent properties, so that one updated meanwhile requests a new flush.
+        if (urgentFlushRequested && isMsElapsed(nowMs, latestUrgentFlushMs, urgentMinIntervalMs) && __atomic_exchange_n(&urgentFlushRequested, false, __ATOMIC_RELAXED))
+        {
+            bool complete;
+            if (addUrgentPropsToSyncBuffer(bufIdx, nowMs, &complete) > 0)
+            {
+                latestUrgentFlushMs = nowMs;
+            }
+            if (!complete)
+            {
+                __atomic_store_n(&urgentFlushRequested, true, __ATOMIC_RELAXED); // Still debouncing or didn't fit, flush again
+            }
+        }
+
+        // If there is at least a property in the JSON string to publish, hand it to the sender task.
+        if (syncBuffers[bufIdx].json[0] != '\0' && syncBuffers[bufIdx].json[1] != '\0')
+        {
+            active = true;
+            syncBuffers[bufIdx].baseVersion = latestVersion;
+            syncBuffers[bufIdx].targetVersion = ++latestVersion;
+            if (versioningEnabled)
+            {
+                char *jsonTail = &syncBuffers[bufIdx].json[strlen(syncBuffers[bufIdx].json)];
+                sprintf(jsonTail, ",\"%s\":[%" PRIu32 ",%" PRIu32 "]", TRACKLE_PROPS_VERSION_KEY, syncBuffers[bufIdx].baseVersion, syncBuffers[bufIdx].targetVersion); // Room reserved by appendPropertyToJsonString
+            }
+            strcat(syncBuffers[bufIdx].json, "}");
+            syncBuffers[bufIdx].busy = true;
+            syncBuffers[bufIdx].fullSync = fullSync;
+            fullSyncPending = fullSync && deferred > 0; // Continue the first synchronization in the next buffer
+            if (deferred > 0)
+            {
+                ESP_LOGW(TAG, "No room left for %d properties, they will be published later", deferred);
+            }
+            xQueueSend(syncRequestsQueue, &bufIdx, portMAX_DELAY); // Never blocks: at most SYNC_BUFFERS_NUM requests are queued
+        }
+    }
+    return updatePeriod(nowMs, (active && connected) || isPropsActivityPending(connected), connected);
+}
+
+static void tracklePropertiesTaskCode(void *arg)
+{
+
+    TickType_t latestWakeTime = xTaskGetTickCount();
+    uint32_t delayMs = TRACKLE_PROPERTIES_TASK_PERIOD_MS;
+
+    for (;;)
+    {
+        // Wait for next iteration, or for an update of an urgent property.
+        const TickType_t delayTicks = trackleDelayMsToTicks(delayMs);
+        const TickType_t elapsedTicks = xTaskGetTickCount() - latestWakeTime;
+        if (elapsedTicks < delayTicks)
+        {
+            ulTaskNotifyTake(pdTRUE, delayTicks - elapsedTicks);
+        }
+        if (xTaskGetTickCount() - latestWakeTime >= delayTicks)
+        {
+            latestWakeTime += delayTicks;
+        }
+        else
+        {
+            latestWakeTime = xTaskGetTickCount(); // Woken up early, next delay starts now
+        }
+        delayMs = tracklePropertiesTick(xTaskGetTickCount() * portTICK_PERIOD_MS, trackleConnected(trackle_s));
+    }
+}
+
+// Returns the JSON string to be transmitted for the JSON of the properties: its compressed envelope if it's long enough and compression pays off, the JSON itself otherwise.
+static const char *compressJsonIfWorth(const char *json)
+{
+    const int jsonLen = strlen(json);
+    if (compressionThreshold <= 0 || jsonLen < compressionThreshold)
+    {
+        return json;
+    }
+    const int compressedLen = Trackle_Compression_compress(&compressionWorkspace, (const uint8_t *)json, jsonLen, compressedJson, sizeof(compressedJson));
+    if (compressedLen < 0)
+    {
+        return json; // Incompressible, longer than the original
+    }
+    const int prefixLen = snprintf(compressedJsonEnvelope, sizeof(compressedJsonEnvelope), "{\"%s\":\"", TRACKLE_COMPRESSION_ENVELOPE_KEY);
+    const int encodedLen = Trackle_Compression_base64Encode(compressedJson, compressedLen, compressedJsonEnvelope + prefixLen, sizeof(compressedJsonEnvelope) - prefixLen);
+    if (encodedLen < 0 || prefixLen + encodedLen + 2 >= jsonLen)
+    {
+        return json; // Envelope not shorter than the original
+    }
+    strcpy(compressedJsonEnvelope + prefixLen + encodedLen, "\"}");
+    ESP_LOGD(TAG, "Synchronization compressed from %d to %d chars", jsonLen, prefixLen + encodedLen + 2);
+    return compressedJsonEnvelope;
+}
+
+bool tracklePropertiesTransmit(TickType_t ticksToWait)
+{
+    SyncResult_t result;
+    if (xQueueReceive(syncRequestsQueue, &result.bufferIndex, ticksToWait) != pdTRUE)
+    {
+        return false;
+    }
+    result.success = trackleSyncStateSecure(compressJsonIfWorth(syncBuffers[result.bufferIndex].json));
+    xQueueSend(syncResultsQueue, &result, portMAX_DELAY);
+    return true;
+}
+
+// Transmit the buffers filled by the properties task, so that a slow link doesn't delay the gathering of changes.
+static void tracklePropertiesSenderTaskCode(void *arg)
+{
+    for (;;)
+    {
+        tracklePropertiesTransmit(portMAX_DELAY);
+    }
+}
+
+bool tracklePropertiesStart(bool senderTask)
+{
+    if (syncRequestsQueue != NULL)
+    {
+        ESP_LOGE(TAG, "Already started.");
+        return false;
+    }
+
+    // Consider this instant as 0 in the time of the properties
+    const uint32_t nowMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    for (int pgIdx = 0; pgIdx < numPropGroupsCreated; pgIdx++)
+    {
+        propGroups[pgIdx].latestWakeTimeMs = nowMs;
+    }
+
+    syncRequestsQueue = xQueueCreate(SYNC_BUFFERS_NUM, sizeof(int));
+    syncResultsQueue = xQueueCreate(SYNC_BUFFERS_NUM, sizeof(SyncResult_t));
+    if (syncRequestsQueue == NULL || syncResultsQueue == NULL)
+    {
+        ESP_LOGE(TAG, "Error in queues creation.");
+        tracklePropertiesCancelStart();
+        return false;
+    }
+
+    if (!senderTask)
+    {
+        return true;
+    }
+
+    // Task creation
+    BaseType_t taskCreationRes;
+
+    taskCreationRes = xTaskCreatePinnedToCore(tracklePropertiesSenderTaskCode,
+                                              TRACKLE_PROPERTIES_SENDER_TASK_NAME,
+                                              TRACKLE_PROPERTIES_SENDER_TASK_STACK_SIZE,
+                                              NULL,
+                                              TRACKLE_PROPERTIES_TASK_PRIORITY,
+                                              NULL,
+                                              TRACKLE_PROPERTIES_TASK_CORE_ID);
+
+    if (taskCreationRes != pdTRUE)
+    {
+        ESP_LOGE(TAG, "Error in sender task creation.");
+        return false;
+    }
+    return true;
+}
+
+void tracklePropertiesCancelStart()
+{
+    if (syncRequestsQueue != NULL)
+    {
+        vQueueDelete(syncRequestsQueue);
+        syncRequestsQueue = NULL;
+    }
+    if (syncResultsQueue != NULL)
+    {
+        vQueueDelete(syncResultsQueue);
+        syncResultsQueue = NULL;
+    }
+}
+
+void tracklePropertiesSetTaskHandle(TaskHandle_t taskHandle)
+{
+    propertiesTaskHandle = taskHandle;
+}
+
+bool Trackle_Props_startTask()
+{
+
+    ESP_LOGI(TAG, "Initializing...");
+
+    if (!tracklePropertiesStart(true))
+    {
+        return false;
+    }
+
+    // Task creation
+    BaseType_t taskCreationRes;
+
+    taskCreationRes = xTaskCreatePinnedToCore(tracklePropertiesTaskCode,
+                                              TRACKLE_PROPERTIES_TASK_NAME,
+                                              TRACKLE_PROPERTIES_TASK_STACK_SIZE,
+                                              NULL,
+                                              TRACKLE_PROPERTIES_TASK_PRIORITY,
+                                              &propertiesTaskHandle,
+                                              TRACKLE_PROPERTIES_TASK_CORE_ID);
+
+    if (taskCreationRes == pdTRUE)
+    {
+        ESP_LOGI(TAG, "Task created successfully.");
+        return true;
+    }
+    ESP_LOGE(TAG, "Error in task creation.");
+    return false;
+}
+
+int Trackle_Props_getNumber()
+{
+    return numPropsCreated;
+}
+
+// Check the name and initialize the fields common to every type of property.
+// Returns the index of the new property, or -1 on failure. The property is counted as created only after commitNewProp is called.
+static int initNewProp(const char *name, Trackle_PropType_t type)
+{
+    if (numPropsCreated < TRACKLE_MAX_PROPS_NUM)
+    {
+        const int newPropIndex = numPropsCreated;
+        if (findPropIndexByKey(name) >= 0)
+        {
+            return -1;
+        }
+        if (strlen(name) < TRACKLE_MAX_PROP_NAME_LENGTH)
+        {
+            strcpy(props[newPropIndex].key, name);
+        }
+        else
+        {
+            return -1;
+        }
+        props[newPropIndex].type = type;
+        props[newPropIndex].scale = 1;
+        props[newPropIndex].sign = 0;
+        props[newPropIndex].numDecimals = 0;
+        props[newPropIndex].debounceDelayMs = 0;
+        props[newPropIndex].stringSlots[0] = NULL;
+        props[newPropIndex].stringSlots[1] = NULL;
+        props[newPropIndex].setStringSlot = 0;
+        props[newPropIndex].pubStringSlot = 0;
+        props[newPropIndex].stringValueMaxLength = 0;
+        props[newPropIndex].validator = NULL;
+        props[newPropIndex].series = NULL;
+        propLastPubValues[newPropIndex].raw = 0;
+        propSetValues[newPropIndex].raw = 0;
+        propLatestSetTimesMs[newPropIndex] = 0;
+        propVersions[newPropIndex] = 0;
+        propPendingSyncBuffers[newPropIndex] = NO_SYNC_BUFFER;
+        bitsetAssign(propChangedBits, newPropIndex, defaultChanged);
+        bitsetAssign(propDebouncingBits, newPropIndex, false);
+        bitsetAssign(propDisabledBits, newPropIndex, false);
+        bitsetAssign(propUrgentBits, newPropIndex, false);
+        bitsetAssign(propStringBits, newPropIndex, type == TRACKLE_PROP_TYPE_STRING);
+        bitsetAssign(propSeriesBits, newPropIndex, type == TRACKLE_PROP_TYPE_SERIES);
+        bitsetAssign(propUnsyncedBits, newPropIndex, true);
+        bitsetAssign(propResendBits, newPropIndex, false);
+        return newPropIndex;
+    }
+    return -1;
+}
+
+// Make the property initialized by initNewProp visible, and return its ID.
+static Trackle_PropID_t commitNewProp(int newPropIndex)
+{
+    propKeyTable[findKeyTableSlot(props[newPropIndex].key)] = newPropIndex + 1;
+    numPropsCreated++;
+    return newPropIndex + 1; // Convert internal property index to property ID by incrementing it.
+}
+
+Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t numDecimals, bool sign)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_FIXED);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    propLastPubValues[newPropIndex].fixed = defaultValue;
+    propSetValues[newPropIndex].fixed = defaultValue;
+    props[newPropIndex].scale = scale;
+    props[newPropIndex].sign = sign;
+    props[newPropIndex].numDecimals = numDecimals;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_STRING);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    if (maxLength < 0 || maxLength > UINT16_MAX)
+        return Trackle_PropID_ERROR;
+    if (strlen(name) + maxLength + STRING_PROP_JSON_OVERHEAD > JSON_BUFFER_LEN - VERSION_MEMBER_MAX_LEN)
+    {
+        ESP_LOGE(TAG, "%s is too long to fit in a sync buffer, max length + name length must be at most %d", name, (int)(JSON_BUFFER_LEN - VERSION_MEMBER_MAX_LEN - STRING_PROP_JSON_OVERHEAD));
+        return Trackle_PropID_ERROR;
+    }
+    char *slots = malloc(2 * (maxLength * sizeof(char) + 1)); // +1 for null character
+    if (slots == NULL)
+        return Trackle_PropID_ERROR;
+    props[newPropIndex].stringSlots[0] = slots;
+    props[newPropIndex].stringSlots[1] = slots + maxLength + 1;
+    props[newPropIndex].stringSlots[0][0] = '\0';
+    props[newPropIndex].stringSlots[1][0] = '\0';
+    propSetValues[newPropIndex].string.hash = hashString(EMPTY_STRING, 0);
+    propLastPubValues[newPropIndex].string.hash = hashString(EMPTY_STRING, 0);
+    props[newPropIndex].stringValueMaxLength = maxLength;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createBool(const char *name)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_BOOL);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createInt64(const char *name)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_INT64);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    props[newPropIndex].sign = true;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createUint64(const char *name)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_UINT64);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createFloat(const char *name, uint8_t numDecimals)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_FLOAT);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    props[newPropIndex].sign = true;
+    props[newPropIndex].numDecimals = numDecimals;
+    return commitNewProp(newPropIndex);
+}
+
+Trackle_PropID_t Trackle_Prop_createSeries(const char *name, int capacity, uint16_t scale, uint8_t numDecimals)
+{
+    const int newPropIndex = initNewProp(name, TRACKLE_PROP_TYPE_SERIES);
+    if (newPropIndex < 0)
+        return Trackle_PropID_ERROR;
+    if (capacity <= 0 || capacity > UINT16_MAX)
+        return Trackle_PropID_ERROR;
+    SeriesBuffer_t *series = malloc(sizeof(SeriesBuffer_t) + capacity * sizeof(SeriesSample_t));
+    if (series == NULL)
+        return Trackle_PropID_ERROR;
+    series->writeCount = 0;
+    series->readCount = 0;
+    series->inFlight = 0;
+    series->serialized = 0;
+    series->capacity = capacity;
+    props[newPropIndex].series = series;
+    props[newPropIndex].scale = scale;
+    props[newPropIndex].numDecimals = numDecimals;
+    bitsetAssign(propChangedBits, newPropIndex, true); // Published whenever there are new samples
+    return commitNewProp(newPropIndex);
+}
+
+// Tell the properties task that the property changed, waking it up if the property is urgent or the task is waiting longer than its min period.
+static void signalPropChange(int propIndex)
+{
+    const bool urgent = bitsetGet(propUrgentBits, propIndex);
+    if (urgent)
+    {
+        urgentFlushRequested = true;
+    }
+    changedSinceTick = true;
+    if ((urgent || currentPeriodMs > minPeriodMs) && propertiesTaskHandle != NULL)
+    {
+        xTaskNotifyGive(propertiesTaskHandle);
+    }
+}
+
+// Start the debounce of a property whose value was just changed.
+static void markPropSet(int propIndex)
+{
+    bitsetAssign(propDebouncingBits, propIndex, true);
+    propLatestSetTimesMs[propIndex] = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    signalPropChange(propIndex);
+}
+
+// Returns the index of the property if it exists and has the given type, -1 otherwise.
+static int getPropIndexOfType(Trackle_PropID_t propID, Trackle_PropType_t type)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated && props[propIndex].type == type)
+    {
+        return propIndex;
+    }
+    return -1;
+}
+
+bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_FIXED);
+    if (propIndex >= 0 && propSetValues[propIndex].fixed != newValue)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIi32 ", new: %d", props[propIndex].key, propSetValues[propIndex].fixed, newValue);
+        propSetValues[propIndex].fixed = newValue;
+        markPropSet(propIndex);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_STRING);
+    if (propIndex < 0 || newValue == NULL)
+    {
+        return false;
+    }
+    Prop_t *prop = &props[propIndex];
+    const uint16_t newLength = strnlen(newValue, prop->stringValueMaxLength);
+    const uint32_t newHash = hashString(newValue, newLength);
+    char *setString = prop->stringSlots[prop->setStringSlot];
+    if (newHash == propSetValues[propIndex].string.hash && newLength == propSetValues[propIndex].string.length && memcmp(setString, newValue, newLength) == 0)
+    {
+        return false;
+    }
+    ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %s, new: %.*s", prop->key, setString, (int)newLength, newValue);
+    if (prop->setStringSlot == prop->pubStringSlot)
+    {
+        prop->setStringSlot ^= 1; // Keep the published value, write to the other slot
+    }
+    setString = prop->stringSlots[prop->setStringSlot];
+    memcpy(setString, newValue, newLength);
+    setString[newLength] = '\0';
+    propSetValues[propIndex].string.hash = newHash;
+    propSetValues[propIndex].string.length = newLength;
+    propSetValues[propIndex].string.generation++;
+    markPropSet(propIndex);
+    return true;
+}
+
+bool Trackle_Prop_updateBool(Trackle_PropID_t propID, bool newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_BOOL);
+    if (propIndex >= 0 && propSetValues[propIndex].boolean != newValue)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %d, new: %d", props[propIndex].key, propSetValues[propIndex].boolean, newValue);
+        propSetValues[propIndex].boolean = newValue;
+        markPropSet(propIndex);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_updateInt64(Trackle_PropID_t propID, int64_t newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_INT64);
+    if (propIndex >= 0 && propSetValues[propIndex].int64 != newValue)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIi64 ", new: %" PRIi64, props[propIndex].key, propSetValues[propIndex].int64, newValue);
+        propSetValues[propIndex].int64 = newValue;
+        markPropSet(propIndex);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_updateUint64(Trackle_PropID_t propID, uint64_t newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_UINT64);
+    if (propIndex >= 0 && propSetValues[propIndex].uint64 != newValue)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %" PRIu64 ", new: %" PRIu64, props[propIndex].key, propSetValues[propIndex].uint64, newValue);
+        propSetValues[propIndex].uint64 = newValue;
+        markPropSet(propIndex);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_updateFloat(Trackle_PropID_t propID, float newValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_FLOAT);
+    if (!isfinite(newValue))
+    {
+        ESP_LOGW(TAG, "Non finite value for %s rejected, it can't be published in JSON", propIndex >= 0 ? props[propIndex].key : "unknown property");
+        return false;
+    }
+    if (propIndex >= 0 && propSetValues[propIndex].real != newValue)
+    {
+        ESP_LOGD(TAG, "PROP CHANGED ---- %s: old: %f, new: %f", props[propIndex].key, (double)propSetValues[propIndex].real, (double)newValue);
+        propSetValues[propIndex].real = newValue;
+        markPropSet(propIndex);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_addSample(Trackle_PropID_t propID, int32_t value)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_SERIES);
+    if (propIndex < 0)
+    {
+        return false;
+    }
+    SeriesBuffer_t *series = props[propIndex].series;
+    const uint32_t writeCount = series->writeCount;
+    if (writeCount - series->readCount >= series->capacity)
+    {
+        ESP_LOGD(TAG, "Series %s is full, sample discarded", props[propIndex].key);
+        return false;
+    }
+    SeriesSample_t *sample = &series->samples[writeCount % series->capacity];
+    sample->timeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    sample->value = value;
+    series->writeCount = writeCount + 1; // Publish the sample to the properties task only after writing it
+    signalPropChange(propIndex);
+    return true;
+}
+
+bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        bitsetAssign(propDisabledBits, propIndex, isDisabled);
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_setUrgent(Trackle_PropID_t propID, bool isUrgent)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        bitsetAssign(propUrgentBits, propIndex, isUrgent);
+        return true;
+    }
+    return false;
+}
+
+void Trackle_Props_setUrgentMinInterval(uint32_t minIntervalMs)
+{
+    urgentMinIntervalMs = minIntervalMs;
+}
+
+bool Trackle_Props_setAdaptivePeriod(uint32_t newMinPeriodMs, uint32_t newMaxPeriodMs)
+{
+    if (newMinPeriodMs == 0 || newMaxPeriodMs < newMinPeriodMs)
+    {
+        return false;
+    }
+    minPeriodMs = newMinPeriodMs;
+    maxPeriodMs = newMaxPeriodMs;
+    currentPeriodMs = newMinPeriodMs;
+    return true;
+}
+
+uint32_t Trackle_Props_getCurrentPeriod()
+{
+    return currentPeriodMs;
+}
+
+void Trackle_Props_setCompressionThreshold(int minLength)
+{
+    compressionThreshold = minLength;
+}
+
+bool Trackle_Props_setVersioning(bool enabled)
+{
+    if (syncRequestsQueue != NULL)
+    {
+        ESP_LOGE(TAG, "Versioning can't be changed after start.");
+        return false;
+    }
+    versioningEnabled = enabled;
+    return true;
+}
+
+uint32_t Trackle_Props_getSyncVersion()
+{
+    return latestVersion;
+}
+
+uint32_t Trackle_Props_getAckedSyncVersion()
+{
+    return ackedVersion;
+}
+
+void Trackle_Props_resyncSince(uint32_t version)
+{
+    resyncSinceVersion = version;
+    resyncRequested = true;
+    if (propertiesTaskHandle != NULL)
+    {
+        xTaskNotifyGive(propertiesTaskHandle);
+    }
+}
+
+bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs)
 {
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
@@ -427,7 +1462,7 @@ bool Trackle_Prop_isDisabled(Trackle_PropID_t propID)
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        return props[propIndex].disabled;
+        return bitsetGet(propDisabledBits, propIndex);
     }
     return false;
 }
@@ -444,10 +1479,10 @@ const char *Trackle_Prop_getKey(Trackle_PropID_t propID)
 
 int32_t Trackle_Prop_getValue(Trackle_PropID_t propID)
 {
-    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
-    if (propIndex >= 0 && propIndex < numPropsCreated)
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_FIXED);
+    if (propIndex >= 0)
     {
-        return props[propIndex].setValue;
+        return propSetValues[propIndex].fixed;
     }
     return -1;
 }
@@ -457,9 +1492,9 @@ bool Trackle_Prop_getStringValue(Trackle_PropID_t propID, char *retValue, int re
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
     if (propIndex >= 0 && propIndex < numPropsCreated)
     {
-        if (props[propIndex].setStringValue != NULL)
+        if (bitsetGet(propStringBits, propIndex))
         {
-            strncpy(retValue, props[propIndex].setStringValue, retValueMaxLen);
+            strncpy(retValue, props[propIndex].stringSlots[props[propIndex].setStringSlot], retValueMaxLen);
             retValue[retValueMaxLen] = '\0';
             return true;
         }
@@ -467,6 +1502,70 @@ bool Trackle_Prop_getStringValue(Trackle_PropID_t propID, char *retValue, int re
     return false;
 }
 
+bool Trackle_Prop_getBoolValue(Trackle_PropID_t propID, bool *retValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_BOOL);
+    if (propIndex >= 0)
+    {
+        *retValue = propSetValues[propIndex].boolean;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_getInt64Value(Trackle_PropID_t propID, int64_t *retValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_INT64);
+    if (propIndex >= 0)
+    {
+        *retValue = propSetValues[propIndex].int64;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_getUint64Value(Trackle_PropID_t propID, uint64_t *retValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_UINT64);
+    if (propIndex >= 0)
+    {
+        *retValue = propSetValues[propIndex].uint64;
+        return true;
+    }
+    return false;
+}
+
+bool Trackle_Prop_getFloatValue(Trackle_PropID_t propID, float *retValue)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_FLOAT);
+    if (propIndex >= 0)
+    {
+        *retValue = propSetValues[propIndex].real;
+        return true;
+    }
+    return false;
+}
+
+int Trackle_Prop_getSamplesNumber(Trackle_PropID_t propID)
+{
+    const int propIndex = getPropIndexOfType(propID, TRACKLE_PROP_TYPE_SERIES);
+    if (propIndex >= 0)
+    {
+        return props[propIndex].series->writeCount - props[propIndex].series->readCount;
+    }
+    return -1;
+}
+
+Trackle_PropType_t Trackle_Prop_getType(Trackle_PropID_t propID)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        return props[propIndex].type;
+    }
+    return TRACKLE_PROP_TYPE_FIXED;
+}
+
 uint16_t Trackle_Prop_getScale(Trackle_PropID_t propID)
 {
     const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
@@ -502,3 +1601,489 @@ void Trackle_Prop_setDefaults(int32_t value, bool changed)
     defaultValue = value;
     defaultChanged = changed;
 }
+
+bool Trackle_Prop_setValidator(Trackle_PropID_t propID, Trackle_PropValidator_t validator)
+{
+    const int propIndex = propID - 1; // Convert property ID to internal property index by decrementing it.
+    if (propIndex >= 0 && propIndex < numPropsCreated)
+    {
+        props[propIndex].validator = validator;
+        return true;
+    }
+    return false;
+}
+
+// Cloud-to-device JSON parsing.
+// The payload is parsed in place: strings are unescaped inside the payload buffer itself, so nothing is allocated
+// and the work done is bounded by the payload length.
+
+static char *skipJsonWhitespace(char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static int hexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Parse the JSON string starting at p (that must point to the opening quote), unescaping and null-terminating it in place.
+// Returns a pointer to the first char after the closing quote, or NULL if the string is malformed.
+static char *parseJsonStringInPlace(char *p, const char *end, char **str, int *strLen)
+{
+    if (p >= end || *p != '"')
+        return NULL;
+    p++;
+    char *out = p;
+    *str = p;
+    while (p < end && *p != '"')
+    {
+        if ((unsigned char)*p < 0x20)
+            return NULL; // Control characters must be escaped
+        if (*p != '\\')
+        {
+            *out++ = *p++;
+            continue;
+        }
+        p++;
+        if (p >= end)
+            return NULL;
+        switch (*p)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = *p;
+            break;
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+        {
+            if (end - p < 5)
+                return NULL;
+            uint32_t codePoint = 0;
+            for (int i = 1; i <= 4; i++)
+            {
+                const int digit = hexDigitValue(p[i]);
+                if (digit < 0)
+                    return NULL;
+                codePoint = (codePoint << 4) | digit;
+            }
+            p += 4;
+            // UTF-8 encoding is never longer than the 6 chars of the escape sequence, so writing in place is safe.
+            if (codePoint < 0x80)
+            {
+                *out++ = (char)codePoint;
+            }
+            else if (codePoint < 0x800)
+            {
+                *out++ = (char)(0xC0 | (codePoint >> 6));
+                *out++ = (char)(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                *out++ = (char)(0xE0 | (codePoint >> 12));
+                *out++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (codePoint & 0x3F));
+            }
+            break;
+        }
+        default:
+            return NULL;
+        }
+        p++;
+    }
+    if (p >= end)
+        return NULL;
+    *strLen = out - *str;
+    *out = '\0'; // out never goes past the closing quote
+    return p + 1;
+}
+
+// JSON number as parsed from the payload: (negative ? -1 : 1) * mantissa * 10^exponent
+typedef struct
+{
+    bool negative;
+    int64_t mantissa;
+    int exponent;
+} JsonNumber_t;
+
+// Parse a JSON number keeping its decimal digits, so that it can be converted without floating point errors.
+// Returns a pointer to the first char after the number, or NULL if the number is malformed.
+static char *parseJsonNumber(char *p, const char *end, JsonNumber_t *number)
+{
+    const int64_t MANTISSA_LIMIT = 100000000000000000LL; // Digits beyond this precision are ignored
+    int integerDigits = 0;
+
+    number->negative = false;
+    number->mantissa = 0;
+    number->exponent = 0;
+    if (p < end && *p == '-')
+    {
+        number->negative = true;
+        p++;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; p++, integerDigits++)
+    {
+        if (number->mantissa < MANTISSA_LIMIT)
+            number->mantissa = number->mantissa * 10 + (*p - '0');
+        else
+            number->exponent++;
+    }
+    if (integerDigits == 0)
+        return NULL;
+    if (p < end && *p == '.')
+    {
+        p++;
+        if (p >= end || *p < '0' || *p > '9')
+            return NULL;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            if (number->mantissa < MANTISSA_LIMIT)
+            {
+                number->mantissa = number->mantissa * 10 + (*p - '0');
+                number->exponent--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            negativeExponent = (*p == '-');
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9')
+            return NULL;
+        int explicitExponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            if (explicitExponent < 1000)
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+        number->exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    return p;
+}
+
+// Parse the chars from p to end as an unsigned integer literal, without the precision limit of parseJsonNumber.
+// Returns false if they aren't only digits or the value exceeds UINT64_MAX.
+static bool parseJsonUint64Literal(const char *p, const char *end, uint64_t *result)
+{
+    uint64_t value = 0;
+    for (; p < end; p++)
+    {
+        if (*p < '0' || *p > '9' || value > (UINT64_MAX - (*p - '0')) / 10)
+            return false;
+        value = value * 10 + (*p - '0');
+    }
+    *result = value;
+    return true;
+}
+
+// Convert a JSON number to the integer stored by a property, that is round(number * scale).
+// Digits are processed directly, so a value like 12.34 with scale 100 becomes exactly 1234.
+// Returns false if the result is outside [minValue, maxValue].
+static bool jsonNumberToScaledInt(const JsonNumber_t *number, uint16_t scale, int64_t minValue, int64_t maxValue, int64_t *result)
+{
+    int64_t mantissa = number->mantissa;
+    int exponent = number->exponent;
+    if (scale == 0)
+        return false;
+    // Make room for the multiplication by scale, dropping the least significant digits if needed.
+    while (mantissa > INT64_MAX / scale)
+    {
+        mantissa = (mantissa + 5) / 10;
+        exponent++;
+    }
+    int64_t value = mantissa * scale;
+    if (exponent > 0)
+    {
+        for (; exponent > 0 && value != 0; exponent--)
+        {
+            if (value > INT64_MAX / 10)
+                return false;
+            value *= 10;
+        }
+    }
+    else if (exponent < 0)
+    {
+        if (exponent < -18)
+        {
+            value = 0;
+        }
+        else
+        {
+            int64_t divisor = 1;
+            for (; exponent < 0; exponent++)
+                divisor *= 10;
+            value = (value + divisor / 2) / divisor; // Round half away from zero (sign is applied later)
+        }
+    }
+    value = number->negative ? -value : value;
+    if (value < minValue || value > maxValue)
+        return false;
+    *result = value;
+    return true;
+}
+
+static float jsonNumberToFloat(const JsonNumber_t *number)
+{
+    double value = (double)number->mantissa;
+    const int exponent = number->exponent < -60 ? -60 : (number->exponent > 60 ? 60 : number->exponent); // Beyond float range anyway
+    for (int e = 0; e < exponent; e++)
+        value *= 10;
+    for (int e = 0; e > exponent; e--)
+        value /= 10;
+    return (float)(number->negative ? -value : value);
+}
+
+// Skip a JSON value of any kind (including nested objects and arrays) without interpreting it.
+static char *skipJsonValue(char *p, const char *end)
+{
+    int depth = 0;
+    do
+    {
+        p = skipJsonWhitespace(p, end);
+        if (p >= end)
+            return NULL;
+        if (*p == '"')
+        {
+            char *str;
+            int strLen;
+            p = parseJsonStringInPlace(p, end, &str, &strLen);
+            if (p == NULL)
+                return NULL;
+        }
+        else if (*p == '{' || *p == '[')
+        {
+            depth++;
+            p++;
+        }
+        else if (*p == '}' || *p == ']' || *p == ',' || *p == ':')
+        {
+            if (depth == 0)
+                return NULL;
+            if (*p == '}' || *p == ']')
+                depth--;
+            p++;
+        }
+        else
+        {
+            const char *start = p;
+            while (p < end && ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z') || *p == '-' || *p == '+' || *p == '.' || *p == 'E'))
+                p++;
+            if (p == start)
+                return NULL;
+        }
+    } while (depth > 0);
+    return p;
+}
+
+static bool isJsonLiteral(const char *p, const char *end, const char *literal)
+{
+    const int literalLen = strlen(literal);
+    return end - p >= literalLen && strncmp(p, literal, literalLen) == 0;
+}
+
+// Parse the JSON value at p and, if it's accepted, write it to the property.
+// Values whose type doesn't match the property are skipped. Returns NULL only if the JSON is malformed.
+static char *applyJsonValueToProp(int propIndex, char *p, const char *end, bool *applied)
+{
+    const Trackle_PropID_t propID = propIndex + 1; // Convert internal property index to property ID by incrementing it.
+    const Trackle_PropValidator_t validator = props[propIndex].validator;
+    *applied = false;
+
+    if (props[propIndex].type == TRACKLE_PROP_TYPE_SERIES)
+    {
+        ESP_LOGW(TAG, "%s is a series, it can't be written from cloud", props[propIndex].key);
+        return skipJsonValue(p, end);
+    }
+    if (props[propIndex].type == TRACKLE_PROP_TYPE_STRING)
+    {
+        if (p >= end || *p != '"')
+        {
+            ESP_LOGW(TAG, "Value of %s from cloud is not a string, ignored", props[propIndex].key);
+            return skipJsonValue(p, end);
+        }
+        char *newStringValue;
+        int newStringValueLen;
+        p = parseJsonStringInPlace(p, end, &newStringValue, &newStringValueLen);
+        if (p == NULL)
+            return NULL;
+        if (newStringValueLen > props[propIndex].stringValueMaxLength)
+        {
+            ESP_LOGW(TAG, "Value of %s from cloud is too long, ignored", props[propIndex].key);
+            return p;
+        }
+        if (validator != NULL && !validator(propID, newStringValue))
+        {
+            ESP_LOGW(TAG, "Value of %s from cloud rejected by validator", props[propIndex].key);
+            return p;
+        }
+        *applied = Trackle_Prop_updateString(propID, newStringValue); // Unchanged values aren't counted
+        return p;
+    }
+
+    // Every other type accepts numbers and booleans (true is 1, false is 0)
+    JsonNumber_t number = {false, 0, 0};
+    const char *numberStart = p;
+    if (isJsonLiteral(p, end, "true"))
+    {
+        number.mantissa = 1;
+        p += 4;
+    }
+    else if (isJsonLiteral(p, end, "false"))
+    {
+        p += 5;
+    }
+    else if (p < end && (*p == '-' || (*p >= '0' && *p <= '9')))
+    {
+        p = parseJsonNumber(p, end, &number);
+        if (p == NULL)
+            return NULL;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Value of %s from cloud is not a number, ignored", props[propIndex].key);
+        return skipJsonValue(p, end);
+    }
+
+    PropValue_t newValue;
+    int64_t intValue = 0;
+    bool inRange = true;
+    switch (props[propIndex].type)
+    {
+    case TRACKLE_PROP_TYPE_BOOL:
+        newValue.boolean = number.mantissa != 0;
+        break;
+    case TRACKLE_PROP_TYPE_INT64:
+        inRange = jsonNumberToScaledInt(&number, 1, INT64_MIN + 1, INT64_MAX, &intValue);
+        newValue.int64 = intValue;
+        break;
+    case TRACKLE_PROP_TYPE_UINT64:
+        // Integer literals can use the whole range, numbers with fraction or exponent are limited to INT64_MAX
+        if (*numberStart >= '0' && *numberStart <= '9' && parseJsonUint64Literal(numberStart, p, &newValue.uint64))
+            break;
+        inRange = jsonNumberToScaledInt(&number, 1, 0, INT64_MAX, &intValue);
+        newValue.uint64 = intValue;
+        break;
+    case TRACKLE_PROP_TYPE_FLOAT:
+        newValue.real = jsonNumberToFloat(&number);
+        inRange = isfinite(newValue.real);
+        break;
+    default:
+        // Scaled properties are signed numbers, the others use the range of their sign
+        if (props[propIndex].scale != 1 || props[propIndex].sign)
+            inRange = jsonNumberToScaledInt(&number, props[propIndex].scale, INT32_MIN, INT32_MAX, &intValue);
+        else
+            inRange = jsonNumberToScaledInt(&number, 1, 0, UINT32_MAX, &intValue);
+        newValue.fixed = (int32_t)intValue;
+        break;
+    }
+    if (!inRange)
+    {
+        ESP_LOGW(TAG, "Value of %s from cloud is out of range, ignored", props[propIndex].key);
+        return p;
+    }
+    if (validator != NULL && !validator(propID, &newValue))
+    {
+        ESP_LOGW(TAG, "Value of %s from cloud rejected by validator", props[propIndex].key);
+        return p;
+    }
+    // Unchanged values aren't counted, as the update functions return false for them
+    switch (props[propIndex].type)
+    {
+    case TRACKLE_PROP_TYPE_BOOL:
+        *applied = Trackle_Prop_updateBool(propID, newValue.boolean);
+        break;
+    case TRACKLE_PROP_TYPE_INT64:
+        *applied = Trackle_Prop_updateInt64(propID, newValue.int64);
+        break;
+    case TRACKLE_PROP_TYPE_UINT64:
+        *applied = Trackle_Prop_updateUint64(propID, newValue.uint64);
+        break;
+    case TRACKLE_PROP_TYPE_FLOAT:
+        *applied = Trackle_Prop_updateFloat(propID, newValue.real);
+        break;
+    default:
+        *applied = Trackle_Prop_update(propID, newValue.fixed);
+        break;
+    }
+    return p;
+}
+
+int Trackle_Props_applyJson(char *payload, int payloadLen)
+{
+    if (payload == NULL || payloadLen <= 0)
+        return -1;
+    const char *end = payload + payloadLen;
+    char *p = skipJsonWhitespace(payload, end);
+    if (p >= end || *p != '{')
+        return -1;
+    p = skipJsonWhitespace(p + 1, end);
+    if (p < end && *p == '}')
+        return 0;
+
+    int numApplied = 0;
+    for (;;)
+    {
+        char *key;
+        int keyLen;
+        p = parseJsonStringInPlace(p, end, &key, &keyLen);
+        if (p == NULL)
+            return -1;
+        p = skipJsonWhitespace(p, end);
+        if (p >= end || *p != ':')
+            return -1;
+        p = skipJsonWhitespace(p + 1, end);
+
+        const int propIndex = findPropIndexByKey(key);
+        if (propIndex < 0)
+        {
+            ESP_LOGD(TAG, "Unknown property %s from cloud, ignored", key);
+            p = skipJsonValue(p, end);
+        }
+        else
+        {
+            bool applied;
+            p = applyJsonValueToProp(propIndex, p, end, &applied);
+            if (applied)
+                numApplied++;
+        }
+        if (p == NULL)
+            return -1;
+
+        p = skipJsonWhitespace(p, end);
+        if (p >= end)
+            return -1;
+        if (*p == '}')
+            return numApplied;
+        if (*p != ',')
+            return -1;
+        p = skipJsonWhitespace(p + 1, end);
+    }
+}
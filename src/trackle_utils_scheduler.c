@@ -0,0 +1,101 @@
+#include <trackle_utils_scheduler.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+
+#include <trackle_esp32.h>
+
+#include "trackle_utils_internal.h"
+
+#define TRACKLE_UTILS_UNIFIED_TASK_NAME "trackle_utils"
+
+static const char *TAG = "trackle_utils_scheduler";
+
+// True if tick has come, handling the wrap around of the tick count.
+static bool isTickReached(TickType_t now, TickType_t tick)
+{
+    return (int32_t)(now - tick) >= 0;
+}
+
+static void trackleUtilsUnifiedTaskCode(void *arg)
+{
+
+    TickType_t propsWakeTime = xTaskGetTickCount();
+    TickType_t notificationsWakeTime = propsWakeTime;
+    uint32_t propsDelayMs = 0; // Run both at the first tick, as their next delay is decided by their iterations
+    uint32_t notificationsDelayMs = 0;
+
+    for (;;)
+    {
+        // Wait for the first of the next iterations, or for an update of an urgent property or of a backed off module.
+        const TickType_t propsNextTick = propsWakeTime + trackleDelayMsToTicks(propsDelayMs);
+        const TickType_t notificationsNextTick = notificationsWakeTime + trackleDelayMsToTicks(notificationsDelayMs);
+        const TickType_t nextTick = isTickReached(notificationsNextTick, propsNextTick) ? propsNextTick : notificationsNextTick;
+        bool notified = false;
+        const TickType_t waitStart = xTaskGetTickCount(); // Read once, a second read after a preemption could be past nextTick
+        if (!isTickReached(waitStart, nextTick))
+        {
+            notified = ulTaskNotifyTake(pdTRUE, nextTick - waitStart) > 0;
+        }
+
+        const TickType_t now = xTaskGetTickCount();
+        const uint32_t nowMs = now * portTICK_PERIOD_MS;
+        const bool connected = trackleConnected(trackle_s);
+
+        // The notification doesn't tell which module was updated, so both run, restarting their wait from now if woken up early.
+        if (isTickReached(now, propsNextTick) || notified)
+        {
+            propsWakeTime = isTickReached(now, propsNextTick) ? propsNextTick : now;
+            propsDelayMs = tracklePropertiesTick(nowMs, connected);
+            while (tracklePropertiesTransmit(0)) // Blocks for the transmissions, there is no sender task
+            {
+            }
+        }
+        if (isTickReached(now, notificationsNextTick) || notified)
+        {
+            notificationsWakeTime = isTickReached(now, notificationsNextTick) ? notificationsNextTick : now;
+            notificationsDelayMs = trackleNotificationsTick(nowMs, connected);
+        }
+    }
+}
+
+bool Trackle_Utils_startUnifiedTask(uint32_t stackSize, uint8_t priority, int coreId)
+{
+
+    ESP_LOGI(TAG, "Initializing...");
+
+    if (!tracklePropertiesStart(false))
+    {
+        return false;
+    }
+    if (!trackleNotificationsStart())
+    {
+        tracklePropertiesCancelStart();
+        return false;
+    }
+
+    // Task creation
+    BaseType_t taskCreationRes;
+    TaskHandle_t taskHandle = NULL;
+
+    taskCreationRes = xTaskCreatePinnedToCore(trackleUtilsUnifiedTaskCode,
+                                              TRACKLE_UTILS_UNIFIED_TASK_NAME,
+                                              stackSize,
+                                              NULL,
+                                              tskIDLE_PRIORITY + priority,
+                                              &taskHandle,
+                                              coreId);
+
+    if (taskCreationRes == pdTRUE)
+    {
+        tracklePropertiesSetTaskHandle(taskHandle);
+        trackleNotificationsSetTaskHandle(taskHandle);
+        ESP_LOGI(TAG, "Task created successfully.");
+        return true;
+    }
+    ESP_LOGE(TAG, "Error in task creation.");
+    trackleNotificationsCancelStart(); // Let the modules be started again, by this function or by their own tasks
+    tracklePropertiesCancelStart();
+    return false;
+}
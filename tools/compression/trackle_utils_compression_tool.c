@@ -0,0 +1,157 @@
+/*
+ * Host tool for the compression of properties synchronizations.
+ *
+ * Build (from the root of the repository):
+ *   cc -O2 -I . -o trackle_utils_compression_tool tools/compression/trackle_utils_compression_tool.c src/trackle_utils_compression.c
+ *
+ * Usage:
+ *   trackle_utils_compression_tool decompress [file]
+ *       Prints the JSON of a compressed synchronization, read from the file or from the standard input. The input can be
+ *       the whole JSON envelope, e.g. {"_lzss":"..."}, or just its base64 string. Inputs that aren't compressed are
+ *       printed as they are.
+ *   trackle_utils_compression_tool bench <file> [<file>...]
+ *       Compresses every file, checks that it decompresses to the original, and prints the compression ratio, the length
+ *       of the JSON envelope and the CPU time per KB of compression and decompression on this host.
+ *
+ * tools/compression/sample_full_sync.json is an example of full synchronization.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <trackle_utils_compression.h>
+
+#define MAX_DATA_LEN (TRACKLE_COMPRESSION_MAX_LENGTH + 1)
+#define MAX_COMPRESSED_LEN (MAX_DATA_LEN + MAX_DATA_LEN / 8 + 16) // Worst case: all literals
+#define MAX_ENCODED_LEN ((MAX_COMPRESSED_LEN + 2) / 3 * 4 + 1)
+#define BENCH_MIN_NS 200000000LL                                   // Min time spent measuring each file and operation
+
+static uint8_t data[MAX_DATA_LEN];
+static uint8_t compressed[MAX_COMPRESSED_LEN];
+static uint8_t decompressed[MAX_DATA_LEN];
+static char encoded[MAX_ENCODED_LEN];
+
+static int readFile(const char *path, uint8_t *buffer, int bufferSize)
+{
+    FILE *file = path != NULL ? fopen(path, "rb") : stdin;
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    const int len = fread(buffer, 1, bufferSize, file);
+    const bool tooLong = len == bufferSize && fgetc(file) != EOF;
+    if (file != stdin)
+        fclose(file);
+    if (tooLong)
+    {
+        fprintf(stderr, "%s: too long\n", path != NULL ? path : "stdin");
+        return -1;
+    }
+    return len;
+}
+
+static long long nowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int decompressCommand(const char *path)
+{
+    int len = readFile(path, data, sizeof(data) - 1);
+    if (len < 0)
+        return EXIT_FAILURE;
+    while (len > 0 && (data[len - 1] == '\n' || data[len - 1] == '\r' || data[len - 1] == ' '))
+        len--;
+    data[len] = '\0';
+
+    // Extract the base64 string from the envelope, if any
+    const char *start = (const char *)data;
+    const char *key = strstr(start, "\"" TRACKLE_COMPRESSION_ENVELOPE_KEY "\"");
+    if (key != NULL)
+    {
+        const char *value = strchr(key + strlen(TRACKLE_COMPRESSION_ENVELOPE_KEY) + 2, '"');
+        if (value == NULL)
+        {
+            fprintf(stderr, "Malformed envelope\n");
+            return EXIT_FAILURE;
+        }
+        start = value + 1;
+        len = strcspn(start, "\"");
+    }
+    else if (len > 0 && data[0] == '{')
+    {
+        printf("%s\n", data); // Not compressed
+        return EXIT_SUCCESS;
+    }
+
+    const int compressedLen = Trackle_Compression_base64Decode(start, len, compressed, sizeof(compressed));
+    const int decompressedLen = compressedLen < 0 ? -1 : Trackle_Compression_decompress(compressed, compressedLen, decompressed, sizeof(decompressed));
+    if (decompressedLen < 0)
+    {
+        fprintf(stderr, "Malformed compressed data\n");
+        return EXIT_FAILURE;
+    }
+    fwrite(decompressed, 1, decompressedLen, stdout);
+    printf("\n");
+    return EXIT_SUCCESS;
+}
+
+static int benchCommand(int numPaths, char **paths)
+{
+    static Trackle_CompressionWorkspace_t workspace;
+    printf("%-40s %8s %10s %8s %8s %14s %16s\n", "file", "bytes", "compressed", "ratio", "envelope", "compress ns/KB", "decompress ns/KB");
+    for (int i = 0; i < numPaths; i++)
+    {
+        const int len = readFile(paths[i], data, sizeof(data));
+        if (len < 0)
+            return EXIT_FAILURE;
+
+        int compressedLen = -1;
+        long long iterations = 0;
+        const long long compressStartNs = nowNs();
+        long long compressNs;
+        do
+        {
+            compressedLen = Trackle_Compression_compress(&workspace, data, len, compressed, sizeof(compressed));
+            iterations++;
+            compressNs = nowNs() - compressStartNs;
+        } while (compressNs < BENCH_MIN_NS);
+        const double compressNsPerKb = (double)compressNs / iterations * 1024 / (len > 0 ? len : 1);
+
+        int decompressedLen = -1;
+        iterations = 0;
+        const long long decompressStartNs = nowNs();
+        long long decompressNs;
+        do
+        {
+            decompressedLen = Trackle_Compression_decompress(compressed, compressedLen, decompressed, sizeof(decompressed));
+            iterations++;
+            decompressNs = nowNs() - decompressStartNs;
+        } while (decompressNs < BENCH_MIN_NS);
+        const double decompressNsPerKb = (double)decompressNs / iterations * 1024 / (len > 0 ? len : 1);
+
+        if (compressedLen < 0 || decompressedLen != len || memcmp(data, decompressed, len) != 0)
+        {
+            fprintf(stderr, "%s: round trip failed\n", paths[i]);
+            return EXIT_FAILURE;
+        }
+        const int envelopeLen = strlen("{\"" TRACKLE_COMPRESSION_ENVELOPE_KEY "\":\"\"}") + Trackle_Compression_base64Encode(compressed, compressedLen, encoded, sizeof(encoded));
+        printf("%-40s %8d %10d %7.1f%% %8d %14.0f %16.0f\n", paths[i], len, compressedLen, 100.0 * compressedLen / (len > 0 ? len : 1), envelopeLen, compressNsPerKb, decompressNsPerKb);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "decompress") == 0 && argc <= 3)
+        return decompressCommand(argc == 3 ? argv[2] : NULL);
+    if (argc >= 3 && strcmp(argv[1], "bench") == 0)
+        return benchCommand(argc - 2, &argv[2]);
+    fprintf(stderr, "Usage: %s decompress [file] | bench <file> [<file>...]\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,12 @@
+// Host shim of the ESP-IDF header, for the simulator: only errors are printed.
+#ifndef SIM_ESP_LOG_H
+#define SIM_ESP_LOG_H
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ((void)(tag))
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+
+#endif
@@ -0,0 +1,5 @@
+// Host shim of the ESP-IDF header, for the simulator.
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#endif
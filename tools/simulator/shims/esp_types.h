@@ -0,0 +1,9 @@
+// Host shim of the ESP-IDF header, for the simulator.
+#ifndef SIM_ESP_TYPES_H
+#define SIM_ESP_TYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#endif
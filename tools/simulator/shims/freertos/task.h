@@ -0,0 +1,14 @@
+// Host shim of the FreeRTOS header, for the simulator. Tasks are never run: the simulator calls their iterations directly.
+#ifndef SIM_FREERTOS_TASK_H
+#define SIM_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+void xTaskNotifyGive(TaskHandle_t taskToNotify);
+BaseType_t xTaskCreatePinnedToCore(void (*taskCode)(void *), const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+
+#endif
@@ -0,0 +1,13 @@
+// Host shim of the Trackle library header, for the simulator. Connectivity and transmissions are emulated by the simulator.
+#ifndef SIM_TRACKLE_ESP32_H
+#define SIM_TRACKLE_ESP32_H
+
+#include <stdbool.h>
+
+extern void *trackle_s;
+
+bool trackleConnected(void *trackle);
+bool trackleSyncStateSecure(const char *data);
+bool tracklePublishSecure(const char *eventName, const char *data);
+
+#endif
@@ -0,0 +1,852 @@
+/*
+ * Trace-driven simulator of the properties and notifications engines.
+ *
+ * The engines are compiled for the host against the shims in the "shims" directory, and their task iterations are run
+ * on a simulated clock while the trace is replayed. At the end, a report with the messages sent, the bytes transmitted,
+ * the change-to-publish latency of every property and the transitions that never reached the cloud is printed.
+ *
+ * Build (from the root of the repository):
+ *   cc -O2 -I tools/simulator/shims -I . -o trackle_utils_simulator tools/simulator/trackle_utils_simulator.c src/trackle_utils_properties.c src/trackle_utils_notifications.c src/trackle_utils_compression.c
+ *
+ * Usage:
+ *   trackle_utils_simulator <trace.csv> [--link-latency-ms N] [--drain-ms N] [--props-period MIN:MAX] [--notifications-period MIN:MAX]
+ *                          [--compression-threshold N] [--versioning]
+ *
+ * The period options enable the adaptive period of the tasks (see Trackle_Props_setAdaptivePeriod), and the report
+ * shows how many iterations each task ran. The compression threshold option enables the compression of the
+ * synchronizations (see Trackle_Props_setCompressionThreshold): bytes are counted as transmitted, and compressed
+ * synchronizations are decompressed before being delivered. The versioning option enables the versions of the
+ * synchronizations (see Trackle_Props_setVersioning): the simulated cloud keeps the latest version it received, and asks
+ * for a resync since it whenever a synchronization doesn't follow it.
+ *
+ * The trace is a CSV file with a line per command, in the form <time_ms>,<command>,<arguments...>. Empty lines and lines
+ * starting with # are ignored. Configuration commands are applied before starting the engines, whatever their time:
+ *   group,<periodMs>,<onlyIfChanged>                          groups get IDs 1, 2, ... in order of creation
+ *   prop,<name>,<scale>,<numDecimals>,<sign>,<groups>[,<debounceMs>[,<urgent>]]
+ *   bool|int64|uint64|float,<name>,<groups>[,<debounceMs>[,<urgent>]]
+ *   string,<name>,<maxLength>,<groups>[,<debounceMs>[,<urgent>]]
+ *   series,<name>,<capacity>,<scale>,<numDecimals>,<groups>[,<debounceMs>[,<urgent>]]
+ *                                                             groups are separated by ';', e.g. 1;3
+ *   notification,<name>,<eventName>,<scale>,<numDecimals>
+ *   hold,<name>,<minHoldMs>                                   min hold time of a notification
+ *   thresholds,<name>,<hysteresis>,<thresholds>               thresholds of a notification, separated by ';', e.g. 50;80
+ * Events are applied at their time, and must be sorted by time:
+ *   update,<name>,<value>                                     value is parsed according to the type of the property,
+ *                                                             for series properties it's a new sample
+ *   notify,<name>,<level>,<value>
+ *   value,<name>,<value>                                      value of a notification with thresholds
+ *   link,up|down                                              the link is up at the beginning of the simulation
+ *
+ * A transition is an update that changes the value of a property (or the level of a notification). It is delivered when
+ * a message that was serialized after it is acknowledged, and its latency is measured up to the acknowledgement. A
+ * transition superseded by a newer one before being delivered, or never delivered, is dropped. Samples of series
+ * properties are never superseded: each of them is delivered by the message that contains it, and the ones discarded
+ * because the series was full are dropped. For value events, a transition is a change of the level computed from the
+ * thresholds without hysteresis, so the ones filtered by hysteresis or by the min hold time are counted as dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <trackle_esp32.h>
+
+#include <trackle_utils_properties.h>
+#include <trackle_utils_notifications.h>
+#include <trackle_utils_compression.h>
+
+#include "../../src/trackle_utils_internal.h"
+
+#define MAX_LINE_LEN 1024
+#define MAX_SIM_QUEUES 8
+#define NOTIFICATION_FORMAT "%s:%u:%s" // Key first, so that the simulator can tell which notification was published
+#define NO_TIME UINT32_MAX
+
+// Shims state
+
+void *trackle_s = NULL;
+
+static uint32_t simNowMs = 0;
+static bool simPropsTaskNotified = false;
+static bool simNotificationsTaskNotified = false;
+static uint32_t simPropsIterations = 0, simNotificationsIterations = 0;
+static bool simLinkUp = true;
+static uint32_t simLatestLinkDownMs = 0;
+static bool simLinkEverDown = false;
+
+typedef struct SimQueue
+{
+    uint8_t *items;
+    uint32_t *enqueueTimesMs;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+} SimQueue_t;
+
+static SimQueue_t *simQueues[MAX_SIM_QUEUES];
+static int numSimQueues = 0;
+static uint32_t simLatestReceivedEnqueueTimeMs = 0;
+
+// Statistics
+
+typedef struct
+{
+    uint32_t *timesMs; // Times of the pending transitions (not delivered yet)
+    int numPending;
+    int capacity;
+    uint32_t *latenciesMs; // Latencies of the delivered transitions
+    int numDelivered;
+    int latenciesCapacity;
+    int numTransitions;
+    int numDropped;
+} TransitionsStats_t;
+
+typedef struct
+{
+    char name[64];
+    Trackle_PropID_t id;
+    TransitionsStats_t stats;
+} SimProp_t;
+
+typedef struct
+{
+    char name[64];
+    Trackle_NotificationID_t id;
+    int latestRequestedLevel;
+    int thresholds[TRACKLE_MAX_NOTIFICATION_THRESHOLDS];
+    int numThresholds;
+    TransitionsStats_t stats;
+} SimNotification_t;
+
+static SimProp_t *simProps = NULL;
+static int numSimProps = 0;
+static SimNotification_t *simNotifications = NULL;
+static int numSimNotifications = 0;
+
+static uint32_t syncsSent = 0, syncsFailed = 0, syncBytes = 0, syncsCompressed = 0;
+static bool cloudVersioning = false;
+static uint32_t cloudVersion = 0, cloudGaps = 0;
+static uint32_t publishesSent = 0, publishesFailed = 0, publishBytes = 0;
+static uint32_t transmissionStartMs = 0;
+
+// FreeRTOS shims
+
+TickType_t xTaskGetTickCount(void)
+{
+    return simNowMs;
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement)
+{
+    *previousWakeTime += timeIncrement;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    return 0;
+}
+
+void xTaskNotifyGive(TaskHandle_t taskToNotify)
+{
+    *(bool *)taskToNotify = true;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*taskCode)(void *), const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+    if (createdTask != NULL)
+    {
+        // Tasks are never run: the handle points to the flag telling the main loop that the task was notified
+        *createdTask = (TaskHandle_t)(strstr(name, "notifications") != NULL ? &simNotificationsTaskNotified : &simPropsTaskNotified);
+    }
+    return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    if (numSimQueues >= MAX_SIM_QUEUES)
+        return NULL;
+    SimQueue_t *queue = calloc(1, sizeof(SimQueue_t));
+    queue->items = calloc(length, itemSize);
+    queue->enqueueTimesMs = calloc(length, sizeof(uint32_t));
+    queue->length = length;
+    queue->itemSize = itemSize;
+    simQueues[numSimQueues++] = queue;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    if (queue->count == queue->length)
+    {
+        fprintf(stderr, "Simulator: queue full, a task would block forever\n");
+        exit(EXIT_FAILURE);
+    }
+    const UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->items[tail * queue->itemSize], item, queue->itemSize);
+    queue->enqueueTimesMs[tail] = simNowMs;
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    if (queue->count == 0)
+        return pdFALSE;
+    memcpy(buffer, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+    simLatestReceivedEnqueueTimeMs = queue->enqueueTimesMs[queue->head];
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    for (int i = 0; i < numSimQueues; i++)
+    {
+        if (simQueues[i] == queue)
+            simQueues[i] = simQueues[--numSimQueues];
+    }
+    free(queue->items);
+    free(queue->enqueueTimesMs);
+    free(queue);
+}
+
+// Transitions bookkeeping
+
+static void addTransition(TransitionsStats_t *stats)
+{
+    if (stats->numPending == stats->capacity)
+    {
+        stats->capacity = stats->capacity ? stats->capacity * 2 : 16;
+        stats->timesMs = realloc(stats->timesMs, stats->capacity * sizeof(uint32_t));
+    }
+    stats->timesMs[stats->numPending++] = simNowMs;
+    stats->numTransitions++;
+}
+
+// Deliver the latest transition happened before serializedAtMs, dropping the older ones.
+static void deliverTransitions(TransitionsStats_t *stats, uint32_t serializedAtMs)
+{
+    int covered = 0;
+    while (covered < stats->numPending && stats->timesMs[covered] <= serializedAtMs)
+        covered++;
+    if (covered == 0)
+        return;
+    if (stats->numDelivered == stats->latenciesCapacity)
+    {
+        stats->latenciesCapacity = stats->latenciesCapacity ? stats->latenciesCapacity * 2 : 16;
+        stats->latenciesMs = realloc(stats->latenciesMs, stats->latenciesCapacity * sizeof(uint32_t));
+    }
+    stats->latenciesMs[stats->numDelivered++] = simNowMs - stats->timesMs[covered - 1];
+    stats->numDropped += covered - 1;
+    memmove(stats->timesMs, &stats->timesMs[covered], (stats->numPending - covered) * sizeof(uint32_t));
+    stats->numPending -= covered;
+}
+
+// Deliver the oldest num transitions, each one with its own latency.
+static void deliverSamples(TransitionsStats_t *stats, int num)
+{
+    if (num > stats->numPending)
+        num = stats->numPending;
+    for (int i = 0; i < num; i++)
+    {
+        if (stats->numDelivered == stats->latenciesCapacity)
+        {
+            stats->latenciesCapacity = stats->latenciesCapacity ? stats->latenciesCapacity * 2 : 16;
+            stats->latenciesMs = realloc(stats->latenciesMs, stats->latenciesCapacity * sizeof(uint32_t));
+        }
+        stats->latenciesMs[stats->numDelivered++] = simNowMs - stats->timesMs[i];
+    }
+    memmove(stats->timesMs, &stats->timesMs[num], (stats->numPending - num) * sizeof(uint32_t));
+    stats->numPending -= num;
+}
+
+// Count the values in the "v" array of a serialized series property.
+static int countSeriesValues(const char *value)
+{
+    const char *p = strstr(value, "\"v\":[");
+    if (p == NULL)
+        return 0;
+    int num = 1;
+    for (p += 5; *p != '\0' && *p != ']'; p++)
+    {
+        if (*p == ',')
+            num++;
+    }
+    return num;
+}
+
+static SimProp_t *findSimProp(const char *name, int nameLen)
+{
+    for (int i = 0; i < numSimProps; i++)
+    {
+        if ((int)strlen(simProps[i].name) == nameLen && strncmp(simProps[i].name, name, nameLen) == 0)
+            return &simProps[i];
+    }
+    return NULL;
+}
+
+static SimNotification_t *findSimNotification(const char *name, int nameLen)
+{
+    for (int i = 0; i < numSimNotifications; i++)
+    {
+        if ((int)strlen(simNotifications[i].name) == nameLen && strncmp(simNotifications[i].name, name, nameLen) == 0)
+            return &simNotifications[i];
+    }
+    return NULL;
+}
+
+// Skip a JSON string starting at the opening quote, returning a pointer after the closing quote.
+static const char *skipJsonString(const char *p)
+{
+    for (p++; *p != '\0' && *p != '"'; p++)
+    {
+        if (*p == '\\' && p[1] != '\0')
+            p++;
+    }
+    return *p == '"' ? p + 1 : p;
+}
+
+// Deliver the transitions of every property found in a JSON object of properties.
+static void deliverSyncedProps(const char *json, uint32_t serializedAtMs)
+{
+    const char *p = strchr(json, '{');
+    if (p == NULL)
+        return;
+    p++;
+    while (*p == '"')
+    {
+        const char *key = p + 1;
+        p = skipJsonString(p);
+        SimProp_t *prop = findSimProp(key, (int)(p - 1 - key));
+        const bool versionKey = strncmp(key, TRACKLE_PROPS_VERSION_KEY "\"", strlen(TRACKLE_PROPS_VERSION_KEY) + 1) == 0;
+        if (*p == ':')
+            p++;
+        uint32_t baseVersion, targetVersion;
+        if (versionKey && cloudVersioning && sscanf(p, "[%" SCNu32 ",%" SCNu32 "]", &baseVersion, &targetVersion) == 2)
+        {
+            if (baseVersion != cloudVersion)
+            {
+                cloudGaps++;
+                Trackle_Props_resyncSince(cloudVersion);
+            }
+            cloudVersion = targetVersion;
+        }
+        if (prop != NULL && Trackle_Prop_getType(prop->id) == TRACKLE_PROP_TYPE_SERIES)
+            deliverSamples(&prop->stats, countSeriesValues(p));
+        else if (prop != NULL)
+            deliverTransitions(&prop->stats, serializedAtMs);
+        int depth = 0;
+        while (*p != '\0' && (depth > 0 || (*p != ',' && *p != '}')))
+        {
+            if (*p == '"')
+            {
+                p = skipJsonString(p);
+                continue;
+            }
+            if (*p == '{' || *p == '[')
+                depth++;
+            else if (*p == '}' || *p == ']')
+                depth--;
+            p++;
+        }
+        if (*p == ',')
+            p++;
+    }
+}
+
+// Trackle library shims
+
+static bool isLinkUpSince(uint32_t startMs)
+{
+    return simLinkUp && (!simLinkEverDown || simLatestLinkDownMs < startMs);
+}
+
+bool trackleConnected(void *trackle)
+{
+    return simLinkUp;
+}
+
+bool trackleSyncStateSecure(const char *data)
+{
+    if (!isLinkUpSince(transmissionStartMs))
+    {
+        syncsFailed++;
+        return false;
+    }
+    syncsSent++;
+    syncBytes += strlen(data);
+    static const char envelopePrefix[] = "{\"" TRACKLE_COMPRESSION_ENVELOPE_KEY "\":\"";
+    if (strncmp(data, envelopePrefix, strlen(envelopePrefix)) == 0)
+    {
+        static uint8_t compressed[MAX_LINE_LEN * 4];
+        static char json[MAX_LINE_LEN * 4];
+        const char *encoded = data + strlen(envelopePrefix);
+        const int compressedLen = Trackle_Compression_base64Decode(encoded, strcspn(encoded, "\""), compressed, sizeof(compressed));
+        const int jsonLen = compressedLen < 0 ? -1 : Trackle_Compression_decompress(compressed, compressedLen, (uint8_t *)json, sizeof(json) - 1);
+        if (jsonLen < 0)
+        {
+            fprintf(stderr, "Malformed compressed synchronization %s\n", data);
+            exit(EXIT_FAILURE);
+        }
+        json[jsonLen] = '\0';
+        syncsCompressed++;
+        data = json;
+    }
+    deliverSyncedProps(data, simLatestReceivedEnqueueTimeMs);
+    return true;
+}
+
+bool tracklePublishSecure(const char *eventName, const char *data)
+{
+    if (!simLinkUp)
+    {
+        publishesFailed++;
+        return false;
+    }
+    publishesSent++;
+    publishBytes += strlen(eventName) + strlen(data);
+    const char *separator = strchr(data, ':');
+    SimNotification_t *notification = separator != NULL ? findSimNotification(data, (int)(separator - data)) : NULL;
+    if (notification != NULL)
+        deliverTransitions(&notification->stats, simNowMs);
+    return true;
+}
+
+// Trace parsing
+
+typedef struct
+{
+    uint32_t timeMs;
+    char *command;
+    char *args[8];
+    int numArgs;
+    int lineNum;
+} TraceLine_t;
+
+static TraceLine_t *traceLines = NULL;
+static int numTraceLines = 0;
+
+static void fail(const TraceLine_t *line, const char *message)
+{
+    fprintf(stderr, "Trace line %d: %s\n", line->lineNum, message);
+    exit(EXIT_FAILURE);
+}
+
+static void loadTrace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    char buffer[MAX_LINE_LEN];
+    int lineNum = 0;
+    int capacity = 0;
+    while (fgets(buffer, sizeof(buffer), file) != NULL)
+    {
+        lineNum++;
+        buffer[strcspn(buffer, "\r\n")] = '\0';
+        if (buffer[0] == '\0' || buffer[0] == '#')
+            continue;
+        if (numTraceLines == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            traceLines = realloc(traceLines, capacity * sizeof(TraceLine_t));
+        }
+        TraceLine_t *line = &traceLines[numTraceLines++];
+        memset(line, 0, sizeof(TraceLine_t));
+        line->lineNum = lineNum;
+        char *text = strdup(buffer);
+        char *field = strsep(&text, ",");
+        line->timeMs = strtoul(field, NULL, 10);
+        line->command = strsep(&text, ",");
+        if (line->command == NULL)
+            fail(line, "missing command");
+        // The value of string updates is the rest of the line, commas included
+        const int maxArgs = strcmp(line->command, "update") == 0 ? 2 : 8;
+        while (text != NULL && line->numArgs < maxArgs)
+        {
+            if (line->numArgs == maxArgs - 1)
+            {
+                line->args[line->numArgs++] = text;
+                break;
+            }
+            line->args[line->numArgs++] = strsep(&text, ",");
+        }
+    }
+    fclose(file);
+}
+
+static void addPropToGroups(const TraceLine_t *line, Trackle_PropID_t id, char *groups)
+{
+    for (char *group = strsep(&groups, ";"); group != NULL; group = strsep(&groups, ";"))
+    {
+        if (group[0] != '\0' && !Trackle_PropGroup_addProp(id, atoi(group)))
+            fail(line, "can't add property to group");
+    }
+}
+
+static void configure(const TraceLine_t *line)
+{
+    const char *cmd = line->command;
+    if (strcmp(cmd, "group") == 0)
+    {
+        if (line->numArgs < 2 || Trackle_PropGroup_create(strtoul(line->args[0], NULL, 10), atoi(line->args[1])) == Trackle_PropGroupID_ERROR)
+            fail(line, "can't create group");
+        return;
+    }
+    if (strcmp(cmd, "notification") == 0)
+    {
+        if (line->numArgs < 4)
+            fail(line, "notification needs name, event, scale and decimals");
+        simNotifications = realloc(simNotifications, (numSimNotifications + 1) * sizeof(SimNotification_t));
+        SimNotification_t *notification = &simNotifications[numSimNotifications++];
+        memset(notification, 0, sizeof(SimNotification_t));
+        snprintf(notification->name, sizeof(notification->name), "%s", line->args[0]);
+        notification->id = Trackle_Notification_create(line->args[0], line->args[1], NOTIFICATION_FORMAT, atoi(line->args[2]), atoi(line->args[3]), true);
+        if (notification->id == Trackle_NotificationID_ERROR)
+            fail(line, "can't create notification");
+        return;
+    }
+    if (strcmp(cmd, "hold") == 0 || strcmp(cmd, "thresholds") == 0)
+    {
+        SimNotification_t *notification = line->numArgs >= 2 ? findSimNotification(line->args[0], strlen(line->args[0])) : NULL;
+        if (notification == NULL)
+            fail(line, "unknown notification");
+        if (strcmp(cmd, "hold") == 0)
+        {
+            Trackle_Notification_setMinHold(notification->id, strtoul(line->args[1], NULL, 10));
+            return;
+        }
+        if (line->numArgs < 3)
+            fail(line, "thresholds needs name, hysteresis and thresholds");
+        notification->numThresholds = 0;
+        for (char *threshold = strtok(line->args[2], ";"); threshold != NULL; threshold = strtok(NULL, ";"))
+        {
+            if (notification->numThresholds == TRACKLE_MAX_NOTIFICATION_THRESHOLDS)
+                fail(line, "too many thresholds");
+            notification->thresholds[notification->numThresholds++] = atoi(threshold);
+        }
+        if (!Trackle_Notification_setThresholds(notification->id, notification->thresholds, notification->numThresholds, atoi(line->args[1])))
+            fail(line, "invalid thresholds");
+        return;
+    }
+
+    Trackle_PropID_t id;
+    int groupsArg;
+    if (strcmp(cmd, "prop") == 0 && line->numArgs >= 5)
+    {
+        id = Trackle_Prop_create(line->args[0], atoi(line->args[1]), atoi(line->args[2]), atoi(line->args[3]));
+        groupsArg = 4;
+    }
+    else if (strcmp(cmd, "string") == 0 && line->numArgs >= 3)
+    {
+        id = Trackle_Prop_createString(line->args[0], atoi(line->args[1]));
+        groupsArg = 2;
+    }
+    else if (strcmp(cmd, "series") == 0 && line->numArgs >= 5)
+    {
+        id = Trackle_Prop_createSeries(line->args[0], atoi(line->args[1]), atoi(line->args[2]), atoi(line->args[3]));
+        groupsArg = 4;
+    }
+    else if (line->numArgs >= 2 && (strcmp(cmd, "bool") == 0 || strcmp(cmd, "int64") == 0 || strcmp(cmd, "uint64") == 0 || strcmp(cmd, "float") == 0))
+    {
+        if (strcmp(cmd, "bool") == 0)
+            id = Trackle_Prop_createBool(line->args[0]);
+        else if (strcmp(cmd, "int64") == 0)
+            id = Trackle_Prop_createInt64(line->args[0]);
+        else if (strcmp(cmd, "uint64") == 0)
+            id = Trackle_Prop_createUint64(line->args[0]);
+        else
+            id = Trackle_Prop_createFloat(line->args[0], 3);
+        groupsArg = 1;
+    }
+    else
+    {
+        fail(line, "unknown or incomplete configuration command");
+        return;
+    }
+    if (id == Trackle_PropID_ERROR)
+        fail(line, "can't create property");
+    simProps = realloc(simProps, (numSimProps + 1) * sizeof(SimProp_t));
+    SimProp_t *prop = &simProps[numSimProps++];
+    memset(prop, 0, sizeof(SimProp_t));
+    snprintf(prop->name, sizeof(prop->name), "%s", line->args[0]);
+    prop->id = id;
+    addPropToGroups(line, id, line->args[groupsArg]);
+    if (line->numArgs > groupsArg + 1)
+        Trackle_Prop_setDebounceDelay(id, strtoul(line->args[groupsArg + 1], NULL, 10));
+    if (line->numArgs > groupsArg + 2)
+        Trackle_Prop_setUrgent(id, atoi(line->args[groupsArg + 2]));
+}
+
+static bool isConfigurationCommand(const char *cmd)
+{
+    return strcmp(cmd, "update") != 0 && strcmp(cmd, "notify") != 0 && strcmp(cmd, "value") != 0 && strcmp(cmd, "link") != 0;
+}
+
+static bool updateProp(const SimProp_t *prop, const char *value)
+{
+    switch (Trackle_Prop_getType(prop->id))
+    {
+    case TRACKLE_PROP_TYPE_STRING:
+        return Trackle_Prop_updateString(prop->id, value);
+    case TRACKLE_PROP_TYPE_BOOL:
+        return Trackle_Prop_updateBool(prop->id, strcmp(value, "true") == 0 || atoi(value) != 0);
+    case TRACKLE_PROP_TYPE_INT64:
+        return Trackle_Prop_updateInt64(prop->id, strtoll(value, NULL, 10));
+    case TRACKLE_PROP_TYPE_UINT64:
+        return Trackle_Prop_updateUint64(prop->id, strtoull(value, NULL, 10));
+    case TRACKLE_PROP_TYPE_FLOAT:
+        return Trackle_Prop_updateFloat(prop->id, strtof(value, NULL));
+    case TRACKLE_PROP_TYPE_SERIES:
+        return Trackle_Prop_addSample(prop->id, atoi(value));
+    default:
+        return Trackle_Prop_update(prop->id, atoi(value));
+    }
+}
+
+static void applyEvent(const TraceLine_t *line)
+{
+    const char *cmd = line->command;
+    if (strcmp(cmd, "update") == 0)
+    {
+        if (line->numArgs < 2)
+            fail(line, "update needs name and value");
+        SimProp_t *prop = findSimProp(line->args[0], strlen(line->args[0]));
+        if (prop == NULL)
+            fail(line, "unknown property");
+        if (updateProp(prop, line->args[1]))
+        {
+            addTransition(&prop->stats);
+        }
+        else if (Trackle_Prop_getType(prop->id) == TRACKLE_PROP_TYPE_SERIES)
+        {
+            prop->stats.numTransitions++; // Sample discarded because the series is full
+            prop->stats.numDropped++;
+        }
+    }
+    else if (strcmp(cmd, "notify") == 0)
+    {
+        if (line->numArgs < 3)
+            fail(line, "notify needs name, level and value");
+        SimNotification_t *notification = findSimNotification(line->args[0], strlen(line->args[0]));
+        if (notification == NULL)
+            fail(line, "unknown notification");
+        const int level = atoi(line->args[1]);
+        Trackle_Notification_update(notification->id, level, atoi(line->args[2]));
+        if (level != notification->latestRequestedLevel)
+        {
+            notification->latestRequestedLevel = level;
+            addTransition(&notification->stats);
+        }
+    }
+    else if (strcmp(cmd, "value") == 0)
+    {
+        if (line->numArgs < 2)
+            fail(line, "value needs name and value");
+        SimNotification_t *notification = findSimNotification(line->args[0], strlen(line->args[0]));
+        if (notification == NULL || !Trackle_Notification_updateValue(notification->id, atoi(line->args[1])))
+            fail(line, "unknown notification, or without thresholds");
+        int level = 0;
+        while (level < notification->numThresholds && atoi(line->args[1]) >= notification->thresholds[level])
+            level++;
+        if (level != notification->latestRequestedLevel)
+        {
+            notification->latestRequestedLevel = level;
+            addTransition(&notification->stats);
+        }
+    }
+    else if (strcmp(cmd, "link") == 0)
+    {
+        const bool up = line->numArgs > 0 && strcmp(line->args[0], "up") == 0;
+        if (simLinkUp && !up)
+        {
+            simLatestLinkDownMs = simNowMs;
+            simLinkEverDown = true;
+        }
+        simLinkUp = up;
+    }
+}
+
+// Report
+
+static int compareUint32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, int num, int pct)
+{
+    int rank = (pct * num + 99) / 100; // Nearest rank
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void printTransitionsStats(const char *name, TransitionsStats_t *stats)
+{
+    const int dropped = stats->numDropped + stats->numPending;
+    if (stats->numDelivered == 0)
+    {
+        printf("  %-24s %8d %8d %8d %8s %8s %8s %8s\n", name, stats->numTransitions, 0, dropped, "-", "-", "-", "-");
+        return;
+    }
+    qsort(stats->latenciesMs, stats->numDelivered, sizeof(uint32_t), compareUint32);
+    printf("  %-24s %8d %8d %8d %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", name, stats->numTransitions, stats->numDelivered, dropped,
+           percentile(stats->latenciesMs, stats->numDelivered, 50), percentile(stats->latenciesMs, stats->numDelivered, 90),
+           percentile(stats->latenciesMs, stats->numDelivered, 99), stats->latenciesMs[stats->numDelivered - 1]);
+}
+
+static void printReport(uint32_t endMs)
+{
+    printf("Simulated time: %" PRIu32 " ms\n", endMs);
+    printf("Syncs: %" PRIu32 " sent (%" PRIu32 " compressed), %" PRIu32 " failed, %" PRIu32 " bytes\n", syncsSent, syncsCompressed, syncsFailed, syncBytes);
+    printf("Publishes: %" PRIu32 " sent, %" PRIu32 " failed, %" PRIu32 " bytes\n", publishesSent, publishesFailed, publishBytes);
+    printf("Iterations: %" PRIu32 " properties, %" PRIu32 " notifications\n", simPropsIterations, simNotificationsIterations);
+    if (cloudVersioning)
+        printf("Versions: %" PRIu32 " sent, %" PRIu32 " acked, %" PRIu32 " gaps detected by the cloud\n", Trackle_Props_getSyncVersion(), Trackle_Props_getAckedSyncVersion(), cloudGaps);
+    printf("\n  %-24s %8s %8s %8s %8s %8s %8s %8s\n", "name", "changes", "deliver", "dropped", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int i = 0; i < numSimProps; i++)
+        printTransitionsStats(simProps[i].name, &simProps[i].stats);
+    for (int i = 0; i < numSimNotifications; i++)
+        printTransitionsStats(simNotifications[i].name, &simNotifications[i].stats);
+}
+
+int main(int argc, char **argv)
+{
+    const char *tracePath = NULL;
+    uint32_t linkLatencyMs = 200;
+    uint32_t drainMs = 60000;
+    const char *propsPeriodArg = NULL;
+    const char *notificationsPeriodArg = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--link-latency-ms") == 0 && i + 1 < argc)
+            linkLatencyMs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--drain-ms") == 0 && i + 1 < argc)
+            drainMs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--props-period") == 0 && i + 1 < argc)
+            propsPeriodArg = argv[++i];
+        else if (strcmp(argv[i], "--notifications-period") == 0 && i + 1 < argc)
+            notificationsPeriodArg = argv[++i];
+        else if (strcmp(argv[i], "--compression-threshold") == 0 && i + 1 < argc)
+            Trackle_Props_setCompressionThreshold(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--versioning") == 0)
+            cloudVersioning = Trackle_Props_setVersioning(true);
+        else
+            tracePath = argv[i];
+    }
+    if (tracePath == NULL)
+    {
+        fprintf(stderr, "Usage: %s <trace.csv> [--link-latency-ms N] [--drain-ms N] [--props-period MIN:MAX] [--notifications-period MIN:MAX] [--compression-threshold N] [--versioning]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    uint32_t minMs, maxMs;
+    if (propsPeriodArg != NULL && (sscanf(propsPeriodArg, "%" SCNu32 ":%" SCNu32, &minMs, &maxMs) != 2 || !Trackle_Props_setAdaptivePeriod(minMs, maxMs)))
+    {
+        fprintf(stderr, "Invalid properties period %s\n", propsPeriodArg);
+        return EXIT_FAILURE;
+    }
+    if (notificationsPeriodArg != NULL && (sscanf(notificationsPeriodArg, "%" SCNu32 ":%" SCNu32, &minMs, &maxMs) != 2 || !Trackle_Notifications_setAdaptivePeriod(minMs, maxMs)))
+    {
+        fprintf(stderr, "Invalid notifications period %s\n", notificationsPeriodArg);
+        return EXIT_FAILURE;
+    }
+
+    loadTrace(tracePath);
+    uint32_t lastEventMs = 0;
+    for (int i = 0; i < numTraceLines; i++)
+    {
+        if (isConfigurationCommand(traceLines[i].command))
+            configure(&traceLines[i]);
+        else if (traceLines[i].timeMs < lastEventMs)
+            fail(&traceLines[i], "events must be sorted by time");
+        else
+            lastEventMs = traceLines[i].timeMs;
+    }
+
+    // The properties module creates the queue of the buffers to be transmitted first
+    const int requestsQueueIdx = numSimQueues;
+    if (!Trackle_Props_startTask() || !Trackle_Notifications_startTask())
+    {
+        fprintf(stderr, "Can't start engines\n");
+        return EXIT_FAILURE;
+    }
+    SimQueue_t *syncRequestsQueue = simQueues[requestsQueueIdx];
+
+    const uint32_t endMs = lastEventMs + drainMs;
+    uint32_t propsWakeMs = 0, propsDelayMs = 0;
+    uint32_t notificationsWakeMs = 0, notificationsDelayMs = 0;
+    uint32_t transmissionEndMs = NO_TIME;
+    int lineIdx = 0;
+
+    for (;;)
+    {
+        while (lineIdx < numTraceLines && isConfigurationCommand(traceLines[lineIdx].command))
+            lineIdx++;
+        uint32_t nextMs = propsWakeMs + propsDelayMs;
+        if (notificationsWakeMs + notificationsDelayMs < nextMs)
+            nextMs = notificationsWakeMs + notificationsDelayMs;
+        if (transmissionEndMs < nextMs)
+            nextMs = transmissionEndMs;
+        if (lineIdx < numTraceLines && traceLines[lineIdx].timeMs < nextMs)
+            nextMs = traceLines[lineIdx].timeMs;
+        if (nextMs > endMs)
+            break;
+        simNowMs = nextMs;
+
+        while (lineIdx < numTraceLines && traceLines[lineIdx].timeMs == simNowMs)
+        {
+            if (!isConfigurationCommand(traceLines[lineIdx].command))
+                applyEvent(&traceLines[lineIdx]);
+            lineIdx++;
+        }
+        if (transmissionEndMs == simNowMs)
+        {
+            tracklePropertiesTransmit(0);
+            transmissionEndMs = NO_TIME;
+        }
+        // A task notified (by an urgent property, or by an update while backed off) runs now and restarts its wait
+        if (simNowMs == propsWakeMs + propsDelayMs || simPropsTaskNotified)
+        {
+            simPropsTaskNotified = false;
+            propsWakeMs = simNowMs;
+            propsDelayMs = tracklePropertiesTick(simNowMs, simLinkUp);
+            simPropsIterations++;
+        }
+        if (simNowMs == notificationsWakeMs + notificationsDelayMs || simNotificationsTaskNotified)
+        {
+            simNotificationsTaskNotified = false;
+            notificationsWakeMs = simNowMs;
+            notificationsDelayMs = trackleNotificationsTick(simNowMs, simLinkUp);
+            simNotificationsIterations++;
+        }
+        // The sender takes the next buffer as soon as it's idle
+        while (transmissionEndMs == NO_TIME && syncRequestsQueue->count > 0)
+        {
+            transmissionStartMs = simNowMs;
+            if (linkLatencyMs > 0)
+            {
+                transmissionEndMs = simNowMs + linkLatencyMs;
+                break;
+            }
+            tracklePropertiesTransmit(0);
+        }
+    }
+
+    printReport(endMs);
+    return EXIT_SUCCESS;
+}
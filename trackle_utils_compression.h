@@ -0,0 +1,95 @@
+#ifndef TRACKLE_UTILS_COMPRESSION_H
+#define TRACKLE_UTILS_COMPRESSION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ *
+ * @file trackle_utils_compression.h
+ * @brief Lightweight LZSS compression, used to shrink large properties synchronizations (see \ref Trackle_Props_setCompressionThreshold).
+ *
+ * Functions in this file don't use the heap nor any ESP-IDF API, so that they can be built for the host too (e.g. to decompress payloads on a server).
+ *
+ * A compressed stream is made of:
+ *  - The length of the original data, as 2 bytes little endian;
+ *  - Groups of up to 8 items, each group preceded by a flag byte whose bits, from the least significant one, tell the type of the items:
+ *    - 1: literal, a single byte copied as it is;
+ *    - 0: match, 2 bytes b0 and b1 meaning "copy (b1 & 0x3F) + 3 bytes starting (((b1 >> 6) << 8) | b0) + 1 bytes back in the output".
+ *
+ * When a synchronization is compressed, it's published as a JSON object with a single string member, whose key is \ref TRACKLE_COMPRESSION_ENVELOPE_KEY
+ * and whose value is the base64 (RFC 4648, with padding) encoding of the compressed stream, e.g. {"_lzss":"TQB7..."}.
+ *
+ */
+
+/**
+ * @brief Max distance of a match [bytes]
+ */
+#define TRACKLE_COMPRESSION_WINDOW_SIZE 1024
+
+/**
+ * @brief Number of entries of the hash table used to find matches
+ */
+#define TRACKLE_COMPRESSION_HASH_SIZE 256
+
+/**
+ * @brief Max length of data that can be compressed [bytes]
+ */
+#define TRACKLE_COMPRESSION_MAX_LENGTH 65534
+
+/**
+ * @brief Key of the JSON object wrapping a compressed payload
+ */
+#define TRACKLE_COMPRESSION_ENVELOPE_KEY "_lzss"
+
+/**
+ * @brief Memory used by the compressor to find matches. Its content doesn't need to be initialized, nor preserved between calls.
+ */
+typedef struct
+{
+    uint16_t head[TRACKLE_COMPRESSION_HASH_SIZE];   ///< Latest position (+1) of every hash
+    uint16_t prev[TRACKLE_COMPRESSION_WINDOW_SIZE]; ///< Previous position (+1) with the same hash of every position in the window
+} Trackle_CompressionWorkspace_t;
+
+/**
+ * @brief Compress data.
+ * @param workspace Memory used by the compressor.
+ * @param src Data to be compressed.
+ * @param srcLen Length of the data (max \ref TRACKLE_COMPRESSION_MAX_LENGTH).
+ * @param dst Buffer that will contain the compressed stream.
+ * @param dstSize Size of dst. Compression fails if the compressed stream is longer.
+ * @return Length of the compressed stream, or -1 on failure.
+ */
+int Trackle_Compression_compress(Trackle_CompressionWorkspace_t *workspace, const uint8_t *src, int srcLen, uint8_t *dst, int dstSize);
+
+/**
+ * @brief Decompress a stream produced by \ref Trackle_Compression_compress.
+ * @param src Compressed stream.
+ * @param srcLen Length of the compressed stream.
+ * @param dst Buffer that will contain the decompressed data.
+ * @param dstSize Size of dst.
+ * @return Length of the decompressed data, or -1 if the stream is malformed or doesn't fit in dst.
+ */
+int Trackle_Compression_decompress(const uint8_t *src, int srcLen, uint8_t *dst, int dstSize);
+
+/**
+ * @brief Encode data in base64, with padding, adding a null terminator.
+ * @param src Data to be encoded.
+ * @param srcLen Length of the data.
+ * @param dst Buffer that will contain the encoded string.
+ * @param dstSize Size of dst, null terminator included.
+ * @return Length of the encoded string (null terminator excluded), or -1 if it doesn't fit in dst.
+ */
+int Trackle_Compression_base64Encode(const uint8_t *src, int srcLen, char *dst, int dstSize);
+
+/**
+ * @brief Decode a base64 string, with padding.
+ * @param src String to be decoded.
+ * @param srcLen Length of the string.
+ * @param dst Buffer that will contain the decoded data.
+ * @param dstSize Size of dst.
+ * @return Length of the decoded data, or -1 if the string is malformed or the data doesn't fit in dst.
+ */
+int Trackle_Compression_base64Decode(const char *src, int srcLen, uint8_t *dst, int dstSize);
+
+#endif
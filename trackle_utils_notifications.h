@@ -36,7 +36,26 @@
 /**
  * @brief Max number of notifications that can be created.
  */
+#ifndef TRACKLE_MAX_NOTIFICATIONS_NUM
 #define TRACKLE_MAX_NOTIFICATIONS_NUM 20
+#endif
+
+/**
+ * @brief Max number of thresholds of a notification (see \ref Trackle_Notification_setThresholds).
+ * Each threshold takes 4 bytes in every notification.
+ */
+#ifndef TRACKLE_MAX_NOTIFICATION_THRESHOLDS
+#define TRACKLE_MAX_NOTIFICATION_THRESHOLDS 4
+#endif
+
+/**
+ * @brief Size in bytes of the pool holding names, event names and formats of all the notifications (null terminators included).
+ * Equal strings are stored only once, so notifications sharing the same event name or format take the space of only one of them.
+ * Max value is 65535.
+ */
+#ifndef TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE
+#define TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE 2048
+#endif
 
 /**
  * @brief Value returned on error by functions returning \ref Trackle_NotificationID_t
@@ -56,12 +75,13 @@ typedef int Trackle_NotificationID_t;
  * @param scale Divider to be applied to values used to update the notification (notificationValue = newValue / scale)
  * @param numDecimals Number of decimal digits to be used when publishing the notification value to the cloud. It's used only if \ref scale differs from 1 (otherwise the notification's value is an integer and it doesn't make sense).
  * @param sign If true, the notification's value is signed, otherwise it's unsigned. It's used only if \ref scale equals 1 (otherwise the notification's value is a floating point number and is signed by default).
- * @return ID associated with the new created notification, or \ref Trackle_NotificationID_ERROR on failure.
+ * @return ID associated with the new created notification, or \ref Trackle_NotificationID_ERROR on failure (also when there's no room for the strings in the pool, see \ref TRACKLE_NOTIFICATIONS_STRING_POOL_SIZE).
  */
 Trackle_NotificationID_t Trackle_Notification_create(const char *name, const char *eventName, const char *format, uint16_t scale, uint8_t numDecimals, bool sign);
 
 /**
  * @brief Update the value of an notification.
+ * If the notification has a min hold time, a new level is published only after being held for that time (see \ref Trackle_Notification_setMinHold).
  * @param notificationID ID of the notification to be updated.
  * @param newLevel Unsigned integer representing the level of the notification.
  * @param value New value of the notification.
@@ -69,12 +89,58 @@ Trackle_NotificationID_t Trackle_Notification_create(const char *name, const cha
  */
 bool Trackle_Notification_update(Trackle_NotificationID_t notificationID, uint8_t newLevel, int value);
 
+/**
+ * @brief Update the value of a notification with thresholds, letting the library compute its level (see \ref Trackle_Notification_setThresholds).
+ * @param notificationID ID of the notification to be updated.
+ * @param value New value of the notification.
+ * @return true if update was successful, false otherwise (also if the notification has no thresholds).
+ */
+bool Trackle_Notification_updateValue(Trackle_NotificationID_t notificationID, int value);
+
+/**
+ * @brief Set the time a new level of a notification must be held before being published (0 by default, i.e. published at once).
+ * Levels that change back before this time are never published, so a value oscillating across a threshold doesn't trigger a publication at every change.
+ * While a level is held, the value published with it is the latest one received.
+ * @param notificationID ID of the notification.
+ * @param minHoldMs Time a new level must be held [ms].
+ * @return true if setting was successful, false otherwise.
+ */
+bool Trackle_Notification_setMinHold(Trackle_NotificationID_t notificationID, uint32_t minHoldMs);
+
+/**
+ * @brief Set the thresholds used by \ref Trackle_Notification_updateValue to compute the level of a notification from its value.
+ * The level is the number of thresholds the value reached: 0 below thresholds[0], 1 from thresholds[0] to thresholds[1], and so on.
+ * To avoid levels alternating while the value hovers around a threshold, a threshold is crossed downwards only when the value falls below it by more than hysteresis.
+ * The level is computed from the latest one, in constant time unless the value crosses many thresholds at once.
+ * @param notificationID ID of the notification.
+ * @param thresholds Ascending values where the level increments, in the same unit of the values passed to \ref Trackle_Notification_updateValue. They are copied.
+ * @param numThresholds Number of thresholds (max \ref TRACKLE_MAX_NOTIFICATION_THRESHOLDS), or 0 to remove them.
+ * @param hysteresis Amount the value must fall below a threshold to cross it downwards (0 for no hysteresis).
+ * @return true if setting was successful, false otherwise (also if thresholds aren't ascending or hysteresis is negative).
+ */
+bool Trackle_Notification_setThresholds(Trackle_NotificationID_t notificationID, const int *thresholds, int numThresholds, int hysteresis);
+
 /**
  * @brief Start the task that publishes periodically the notifications created.
  * @return true if task started successfully, false otherwise.
  */
 bool Trackle_Notifications_startTask();
 
+/**
+ * @brief Let the notifications task run less often while notifications don't change (by default it always runs every 1000 ms).
+ * The period of the task doubles at every iteration without changes, up to maxPeriodMs, and returns to minPeriodMs as soon as a notification is updated.
+ * @param minPeriodMs Period of the task while there are notifications to publish [ms]
+ * @param maxPeriodMs Max period of the task while notifications don't change [ms]. If equal to minPeriodMs, the period is fixed.
+ * @return true on success, false if minPeriodMs is 0 or greater than maxPeriodMs.
+ */
+bool Trackle_Notifications_setAdaptivePeriod(uint32_t minPeriodMs, uint32_t maxPeriodMs);
+
+/**
+ * @brief Get the current period of the notifications task (for diagnostics).
+ * @return Period of the task [ms]
+ */
+uint32_t Trackle_Notifications_getCurrentPeriod();
+
 /**
  * @brief Get key of an notification.
  * @param notificationID ID of the notification.
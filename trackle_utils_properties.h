@@ -27,7 +27,7 @@
  *
  * Then, in order to create properties, one must follow these steps:
  *  1. Declare a variable of type \ref Trackle_PropID_t;
- *  2. Assign the result of \ref Trackle_Prop_create or \ref Trackle_Prop_createString to this variable;
+ *  2. Assign the result of one of the Trackle_Prop_create functions (e.g. \ref Trackle_Prop_create, \ref Trackle_Prop_createString) to this variable;
  *  3. Add the created property to one or more groups with \ref Trackle_PropGroup_addProp;
  *  4. Repeat the steps from 1 to 3 for all the properties that must be created;
  *  5. Call \ref Trackle_Props_startTask to start the properties task.
@@ -41,15 +41,26 @@
  */
 #define TRACKLE_MAX_PROP_NAME_LENGTH 20
 
+/**
+ * @brief Key of the member holding the versions of a synchronization of properties (see \ref Trackle_Props_setVersioning).
+ */
+#define TRACKLE_PROPS_VERSION_KEY "_v"
+
 /**
  * @brief Max number of properties groups that can be created.
+ * Each group takes TRACKLE_MAX_PROPS_NUM / 8 bytes to store its membership.
  */
+#ifndef TRACKLE_MAX_PROPGROUPS_NUM
 #define TRACKLE_MAX_PROPGROUPS_NUM 10
+#endif
 
 /**
  * @brief Max number of properties that can be created.
+ * Max value is 65535.
  */
+#ifndef TRACKLE_MAX_PROPS_NUM
 #define TRACKLE_MAX_PROPS_NUM 40
+#endif
 
 /**
  * @brief Value returned on error by functions returning \ref Trackle_PropGroupID_t
@@ -71,6 +82,30 @@ typedef int Trackle_PropGroupID_t;
  */
 typedef int Trackle_PropID_t;
 
+/**
+ * @brief Types of properties.
+ */
+typedef enum
+{
+    TRACKLE_PROP_TYPE_FIXED,  ///< 32 bits integer published divided by a scale, see \ref Trackle_Prop_create.
+    TRACKLE_PROP_TYPE_BOOL,   ///< Boolean, see \ref Trackle_Prop_createBool.
+    TRACKLE_PROP_TYPE_INT64,  ///< Signed 64 bits integer, see \ref Trackle_Prop_createInt64.
+    TRACKLE_PROP_TYPE_UINT64, ///< Unsigned 64 bits integer, see \ref Trackle_Prop_createUint64.
+    TRACKLE_PROP_TYPE_FLOAT,  ///< Floating point, see \ref Trackle_Prop_createFloat.
+    TRACKLE_PROP_TYPE_STRING, ///< String, see \ref Trackle_Prop_createString.
+    TRACKLE_PROP_TYPE_SERIES, ///< Timestamped samples of a 32 bits integer, see \ref Trackle_Prop_createSeries.
+} Trackle_PropType_t;
+
+/**
+ * @brief Type of the callbacks that validate values written to a property from the cloud.
+ * @param propID ID of the property being written.
+ * @param newValue Pointer to the value to be stored. It points to an int32_t (already multiplied by the property's scale) for \ref TRACKLE_PROP_TYPE_FIXED,
+ * a bool for \ref TRACKLE_PROP_TYPE_BOOL, an int64_t for \ref TRACKLE_PROP_TYPE_INT64, an uint64_t for \ref TRACKLE_PROP_TYPE_UINT64,
+ * a float for \ref TRACKLE_PROP_TYPE_FLOAT, and to the null terminated string for \ref TRACKLE_PROP_TYPE_STRING.
+ * @return true to accept the value, false to reject it.
+ */
+typedef bool (*Trackle_PropValidator_t)(Trackle_PropID_t propID, const void *newValue);
+
 /**
  * @brief Create a new properties group, grouping properties that must be published with the same period.
  * @param periodMs Period for the publication of the properties belonging to the group [ms]
@@ -100,11 +135,55 @@ Trackle_PropID_t Trackle_Prop_create(const char *name, uint16_t scale, uint8_t n
 /**
  * @brief Create a new string property.
  * @param name Name/key to be assigned to the property.
- * @param maxLength Maximum length of the string that will be contained in the property.
+ * @param maxLength Maximum length of the string that will be contained in the property. It fails if the property couldn't fit in a synchronization
+ * with a value this long: name and max length together must be shorter than about 1000 chars.
  * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
  */
 Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength);
 
+/**
+ * @brief Create a new boolean property.
+ * @param name Name/key to be assigned to the property.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createBool(const char *name);
+
+/**
+ * @brief Create a new signed 64 bits integer property (e.g. for counters that would overflow a 32 bits property).
+ * @param name Name/key to be assigned to the property.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createInt64(const char *name);
+
+/**
+ * @brief Create a new unsigned 64 bits integer property (e.g. for counters that would overflow a 32 bits property).
+ * @param name Name/key to be assigned to the property.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createUint64(const char *name);
+
+/**
+ * @brief Create a new floating point property. Values are stored as they are, without any scale.
+ * @param name Name/key to be assigned to the property.
+ * @param numDecimals Number of decimal digits to be used when publishing the property to the cloud.
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createFloat(const char *name, uint8_t numDecimals);
+
+/**
+ * @brief Create a new series property, that records timestamped samples and publishes all of them at once when its group fires.
+ * Samples are published as a JSON object like {"age":120,"dt":[100,100],"v":[1.5,1.7,1.6]}, where "v" holds the values (published like the ones of \ref Trackle_Prop_create),
+ * "age" is the time elapsed from the first sample to the publication [ms] and "dt" holds the time between each sample and the previous one [ms].
+ * Samples are removed only when their publication is acknowledged by the cloud. If they don't fit in a single publication, the oldest ones are published first.
+ * Series properties are published only when they have new samples, can't be written from the cloud and ignore the debounce delay.
+ * @param name Name/key to be assigned to the property.
+ * @param capacity Max number of samples waiting to be published. When reached, new samples are discarded until older ones are published.
+ * @param scale Scale factor. Values are divided by this number before being published.
+ * @param numDecimals Number of decimal digits to be used when publishing values (only used if scale is different from 1).
+ * @return ID associated with the new created property, or \ref Trackle_PropID_ERROR on failure.
+ */
+Trackle_PropID_t Trackle_Prop_createSeries(const char *name, int capacity, uint16_t scale, uint8_t numDecimals);
+
 /**
  * @brief Update the value of a numeric property.
  * @param propID ID of the property to be updated.
@@ -113,6 +192,46 @@ Trackle_PropID_t Trackle_Prop_createString(const char *name, int maxLength);
  */
 bool Trackle_Prop_update(Trackle_PropID_t propID, int newValue);
 
+/**
+ * @brief Update the value of a boolean property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if update was successful, false otherwise.
+ */
+bool Trackle_Prop_updateBool(Trackle_PropID_t propID, bool newValue);
+
+/**
+ * @brief Update the value of a signed 64 bits integer property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if update was successful, false otherwise.
+ */
+bool Trackle_Prop_updateInt64(Trackle_PropID_t propID, int64_t newValue);
+
+/**
+ * @brief Update the value of an unsigned 64 bits integer property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property.
+ * @return true if update was successful, false otherwise.
+ */
+bool Trackle_Prop_updateUint64(Trackle_PropID_t propID, uint64_t newValue);
+
+/**
+ * @brief Update the value of a floating point property.
+ * @param propID ID of the property to be updated.
+ * @param newValue New value of the property. NaN and infinite values are rejected, as they can't be published in JSON.
+ * @return true if update was successful, false otherwise.
+ */
+bool Trackle_Prop_updateFloat(Trackle_PropID_t propID, float newValue);
+
+/**
+ * @brief Record a new sample of a series property, timestamped with the current time.
+ * @param propID ID of the property.
+ * @param value Value of the sample (already multiplied by the property's scale).
+ * @return true if the sample was recorded, false otherwise (also if the property has no room left for new samples).
+ */
+bool Trackle_Prop_addSample(Trackle_PropID_t propID, int32_t value);
+
 /**
  * @brief Update the value of a string property.
  * @param propID ID of the property to be updated.
@@ -129,6 +248,79 @@ bool Trackle_Prop_updateString(Trackle_PropID_t propID, const char *newValue);
  */
 bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled);
 
+/**
+ * @brief Mark a property as urgent: when its value changes it is published as soon as possible, without waiting for the period of its groups.
+ * Other changed properties are published along with it, as long as they fit in the same message. See also \ref Trackle_Props_setUrgentMinInterval.
+ * @param propID ID of the property.
+ * @param isUrgent If true, the property is urgent, otherwise it's published only with the period of its groups.
+ * @return true if setting was successful, false otherwise.
+ */
+bool Trackle_Prop_setUrgent(Trackle_PropID_t propID, bool isUrgent);
+
+/**
+ * @brief Set the minimum time between two publications triggered by urgent properties (default 1000 ms). Changes happening within this time are published together.
+ * @param minIntervalMs Minimum time between two publications of urgent properties [ms]
+ */
+void Trackle_Props_setUrgentMinInterval(uint32_t minIntervalMs);
+
+/**
+ * @brief Let the properties task run less often while properties don't change (by default it always runs every 100 ms).
+ * The period of the task doubles at every iteration without changes, up to maxPeriodMs, and returns to minPeriodMs as soon as a property is updated.
+ * Groups are still published on time, as the task never sleeps past the next publication of a group.
+ * @param minPeriodMs Period of the task while properties are changing [ms]
+ * @param maxPeriodMs Max period of the task while properties don't change [ms]. If equal to minPeriodMs, the period is fixed.
+ * @return true on success, false if minPeriodMs is 0 or greater than maxPeriodMs.
+ */
+bool Trackle_Props_setAdaptivePeriod(uint32_t minPeriodMs, uint32_t maxPeriodMs);
+
+/**
+ * @brief Get the current period of the properties task (for diagnostics).
+ * @return Period of the task [ms]
+ */
+uint32_t Trackle_Props_getCurrentPeriod();
+
+/**
+ * @brief Compress the synchronizations of properties at least minLength chars long (compression is disabled by default).
+ * Compressed synchronizations are published wrapped in a JSON object, as described in trackle_utils_compression.h, so the cloud must be able to unwrap them.
+ * A synchronization is published as it is if compression doesn't make it shorter.
+ * @param minLength Min length of the JSON string of the synchronizations to be compressed [chars], or 0 to disable compression.
+ */
+void Trackle_Props_setCompressionThreshold(int minLength);
+
+/**
+ * @brief Add the versions to the synchronizations of properties (versioning is disabled by default). Must be called before starting the properties task.
+ *
+ * Every synchronization handed to the cloud gets a version, incremented by one at each synchronization, and every property remembers the version
+ * of the latest synchronization it was serialized in. With versioning enabled, synchronizations carry a member with key \ref TRACKLE_PROPS_VERSION_KEY
+ * and value [base, target], where target is the version of the synchronization and base is the version of the previous one.
+ * A cloud that keeps the target of the latest synchronization it received can detect lost or reordered ones when base doesn't match it,
+ * and can ask for the missing changes only, by making the device call \ref Trackle_Props_resyncSince with the latest version it received.
+ * @param enabled If true, versions are added to the synchronizations.
+ * @return true if setting was successful, false if the properties task is already started.
+ */
+bool Trackle_Props_setVersioning(bool enabled);
+
+/**
+ * @brief Get the version of the latest synchronization of properties handed to the cloud (0 if none).
+ * @return Version of the latest synchronization.
+ */
+uint32_t Trackle_Props_getSyncVersion();
+
+/**
+ * @brief Get the version of the latest synchronization of properties acknowledged by the cloud (0 if none).
+ * @return Version of the latest acknowledged synchronization.
+ */
+uint32_t Trackle_Props_getAckedSyncVersion();
+
+/**
+ * @brief Publish again every property serialized in a synchronization more recent than the given version, regardless of its groups and of whether it changed.
+ * If the version is more recent than any synchronization (e.g. it was received before a reboot), every property is published again.
+ * Samples of series properties acknowledged by the cloud are not published again.
+ * Resync is started in the next iteration of the properties task, so this function can be called from any task (e.g. from a cloud function).
+ * @param version Version of the latest synchronization received by the cloud (see \ref Trackle_Props_setVersioning).
+ */
+void Trackle_Props_resyncSince(uint32_t version);
+
 /**
  * @brief Set delay that must pass between last set of value and the publishing. A call to \ref Trackle_Prop_update within this delay resets the count.
  * @param propID ID of the property.
@@ -137,6 +329,14 @@ bool Trackle_Prop_setDisabled(Trackle_PropID_t propID, bool isDisabled);
  */
 bool Trackle_Prop_setDebounceDelay(Trackle_PropID_t propID, uint32_t debounceDelayMs);
 
+/**
+ * @brief Set the callback that validates the values written to a property by \ref Trackle_Props_applyJson.
+ * @param propID ID of the property.
+ * @param validator Callback to be used, or NULL to accept every value.
+ * @return true if validator was set successfully, false otherwise.
+ */
+bool Trackle_Prop_setValidator(Trackle_PropID_t propID, Trackle_PropValidator_t validator);
+
 /**
  * @brief Get abilitation of a property.
  * @param propID ID of the property.
@@ -152,9 +352,9 @@ bool Trackle_Prop_isDisabled(Trackle_PropID_t propID);
 const char *Trackle_Prop_getKey(Trackle_PropID_t propID);
 
 /**
- * @brief Get value of a property.
+ * @brief Get value of a numeric property.
  * @param propID ID of the property.
- * @return Value of the property (-1 if \ref propID doesn't identify a valid property)
+ * @return Value of the property (-1 if \ref propID doesn't identify a valid numeric property)
  */
 int32_t Trackle_Prop_getValue(Trackle_PropID_t propID);
 
@@ -167,6 +367,52 @@ int32_t Trackle_Prop_getValue(Trackle_PropID_t propID);
  */
 bool Trackle_Prop_getStringValue(Trackle_PropID_t propID, char *retValue, int retValueMaxLen);
 
+/**
+ * @brief Get value of a boolean property.
+ * @param propID ID of the property.
+ * @param retValue Variable that will contain the actual value of the property.
+ * @return True on success, false on errors
+ */
+bool Trackle_Prop_getBoolValue(Trackle_PropID_t propID, bool *retValue);
+
+/**
+ * @brief Get value of a signed 64 bits integer property.
+ * @param propID ID of the property.
+ * @param retValue Variable that will contain the actual value of the property.
+ * @return True on success, false on errors
+ */
+bool Trackle_Prop_getInt64Value(Trackle_PropID_t propID, int64_t *retValue);
+
+/**
+ * @brief Get value of an unsigned 64 bits integer property.
+ * @param propID ID of the property.
+ * @param retValue Variable that will contain the actual value of the property.
+ * @return True on success, false on errors
+ */
+bool Trackle_Prop_getUint64Value(Trackle_PropID_t propID, uint64_t *retValue);
+
+/**
+ * @brief Get value of a floating point property.
+ * @param propID ID of the property.
+ * @param retValue Variable that will contain the actual value of the property.
+ * @return True on success, false on errors
+ */
+bool Trackle_Prop_getFloatValue(Trackle_PropID_t propID, float *retValue);
+
+/**
+ * @brief Get the number of samples of a series property that are waiting for an acknowledged publication.
+ * @param propID ID of the property.
+ * @return Number of samples, or -1 if the property isn't a series property.
+ */
+int Trackle_Prop_getSamplesNumber(Trackle_PropID_t propID);
+
+/**
+ * @brief Get type of a property.
+ * @param propID ID of the property.
+ * @return Type of the property (\ref TRACKLE_PROP_TYPE_FIXED if \ref propID doesn't identify a valid property)
+ */
+Trackle_PropType_t Trackle_Prop_getType(Trackle_PropID_t propID);
+
 /**
  * @brief Get scale of a property.
  * @param propID ID of the property.
@@ -200,6 +446,23 @@ bool Trackle_Props_startTask();
  */
 int Trackle_Props_getNumber();
 
+/**
+ * @brief Apply to properties the values contained in a JSON object received from the cloud (e.g. {"temp":21.5,"mode":"auto"}).
+ *
+ * The payload is parsed in place without allocating memory, so its content is modified by this function.
+ * Values of properties created with \ref Trackle_Prop_create are multiplied by the scale of the property before being stored
+ * (21.5 with scale 10 is stored as 215). Booleans are accepted by numeric properties as 1 and 0, and numbers by boolean properties. Unknown keys and values whose type doesn't match the property are ignored, while values
+ * rejected by the property's validator (see \ref Trackle_Prop_setValidator) are discarded.
+ * Values outside the range of the property are ignored: once multiplied by the scale, values of signed or scaled properties must fit an int32,
+ * values of unsigned properties an uint32. Values of uint64 properties above INT64_MAX must be written as integer literals (e.g. 18446744073709551615, not 1.8e19).
+ * Values preceding a syntax error in the payload are applied anyway.
+ *
+ * @param payload JSON object to be applied.
+ * @param payloadLen Length of the payload (null terminator excluded).
+ * @return Number of properties whose value changed (values equal to the current ones aren't counted), or -1 if the payload is malformed.
+ */
+int Trackle_Props_applyJson(char *payload, int payloadLen);
+
 /**
  * @brief Set dafault value and changed of a new property
  * @param value Default value of a property
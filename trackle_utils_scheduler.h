@@ -0,0 +1,45 @@
+#ifndef TRACKLE_UTILS_SCHEDULER_H
+#define TRACKLE_UTILS_SCHEDULER_H
+
+#include <stdbool.h>
+#include <esp_types.h>
+
+/**
+ *
+ * @file trackle_utils_scheduler.h
+ * @brief Function for servicing properties and notifications from a single task.
+ *
+ * By default, \ref Trackle_Props_startTask and \ref Trackle_Notifications_startTask create a task each, with its own stack and polling loop,
+ * and properties are transmitted by a further sender task: 8 KB + 8 KB of stack for properties and 8 KB for notifications.
+ * Calling \ref Trackle_Utils_startUnifiedTask instead of both of them, a single task with a single stack (8 KB by default, saving 16 KB)
+ * services properties and notifications, checking the connection once per iteration. Notifications are built in the same static buffer
+ * in both cases, so it isn't part of the stack of either task.
+ * The unified task also transmits the properties, so notifications and the gathering of changes wait while a synchronization is being transmitted.
+ *
+ */
+
+/**
+ * @brief Default stack size of the unified task [bytes], as large as the one of the sender task it replaces, that transmits the properties
+ */
+#define TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_STACK_SIZE 8192
+
+/**
+ * @brief Default priority of the unified task
+ */
+#define TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_PRIORITY 10
+
+/**
+ * @brief Default core of the unified task
+ */
+#define TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_CORE_ID 1
+
+/**
+ * @brief Start the task that publishes both properties and notifications. It must be called instead of \ref Trackle_Props_startTask and \ref Trackle_Notifications_startTask.
+ * @param stackSize Stack size of the task [bytes] (e.g. \ref TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_STACK_SIZE)
+ * @param priority Priority of the task (e.g. \ref TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_PRIORITY)
+ * @param coreId Core where the task runs (e.g. \ref TRACKLE_UTILS_UNIFIED_TASK_DEFAULT_CORE_ID, or tskNO_AFFINITY)
+ * @return true if task started successfully, false otherwise (also if properties or notifications were already started).
+ */
+bool Trackle_Utils_startUnifiedTask(uint32_t stackSize, uint8_t priority, int coreId);
+
+#endif